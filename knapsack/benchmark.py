@@ -0,0 +1,45 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Run the branch and bound with every upper bound on every instance in data, and report the node count and wall time,
+# so that the bound can be picked per workload. Extra arguments are passed to main, e.g.
+# python benchmark.py --reduce=off --order=best
+
+import os
+import re
+import subprocess
+import sys
+import time
+
+BOUNDS = ['dantzig', 'mt']
+TIMEOUT = 60
+
+def instance_size(filename):
+    with open(os.path.join('data', filename), 'r') as f:
+        item_count, capacity = f.readline().split()
+    return int(item_count), int(capacity)
+
+def run(filename, bound, extra_args):
+    command = ['./main', os.path.join('data', filename), '--bound=' + bound] + extra_args
+    start = time.time()
+    try:
+        output = subprocess.run(command, stdout=subprocess.PIPE, universal_newlines=True, timeout=TIMEOUT).stdout
+    except subprocess.TimeoutExpired:
+        return '-', 'timeout'
+
+    match = re.search(r'\[nodes (\d+)\]', output)
+    nodes = match.group(1) if match else '-'
+    return nodes, '%.3fs' % (time.time() - start)
+
+if __name__ == '__main__':
+    extra_args = sys.argv[1:]
+    instances = sorted((f for f in os.listdir('data') if f.startswith('ks_')), key=instance_size)
+
+    print('%-18s' % 'instance' + ''.join('%-16s%-10s' % (bound + ' nodes', 'time') for bound in BOUNDS))
+    for filename in instances:
+        line = '%-18s' % filename
+        for bound in BOUNDS:
+            nodes, seconds = run(filename, bound, extra_args)
+            line += '%-16s%-10s' % (nodes, seconds)
+        print(line)
+        sys.stdout.flush()
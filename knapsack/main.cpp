@@ -1,11 +1,32 @@
 // Knapsack Problem
-// This code solves the 0/1 Knapsack Problem with Branch and Bound method
+// This code solves the 0/1 Knapsack Problem with Branch and Bound method,
+// or with the classic capacity-indexed Dynamic Programming when "--engine=dp" is given
 
 #include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<cstdint>
 #include<vector>
 #include<cassert>
 #include<algorithm>
 #include<tuple>
+#include<limits>
+#include<queue>
+#include<string>
+#include<chrono>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<deque>
+#include<random>
+#include<functional>
+#include<cmath>
+#if defined(__AVX2__)
+#include<immintrin.h>
+#elif defined(__SSE2__)
+#include<emmintrin.h>
+#endif
 using namespace std;
 
 struct Item
@@ -21,94 +42,1384 @@ struct Item
 	}
 };
 
+// command line options, each of them is given in the form of "--name=value"
+struct Options
+{
+	const char * data_file = nullptr;
+
+	// bb: branch and bound, dp: dynamic programming, core: expanding core, pareto: sparse dp over non-dominated states,
+	// fptas: approximation, the value is at least (1 - epsilon) of the max value
+	string engine = "bb";
+
+	// approximation tolerance of the fptas engine
+	double epsilon = 0.1;
+
+	// node exploration order of branch and bound
+	// depth: depth-first, best: best-first, the node with the highest expectation is expanded first
+	string order = "depth";
+
+	// table: keep a bit-packed take/no-take table of n * (capacity + 1) bits
+	// recompute: divide and conquer over the items, only O(capacity) memory is needed
+	string traceback = "table";
+
+	// upper bound used by branch and bound to prune
+	// dantzig: LP relaxation, mt: Martello-Toth U2, which is tighter and a little more expensive
+	string bound = "dantzig";
+
+	// memory of the branch and bound transposition table in MB, 0 to turn it off
+	size_t table_mb = 16;
+
+	// fix variables and drop dominated items before searching
+	bool reduce = true;
+
+	// dp: number of threads that share the capacity range of a dp row
+	// bb: number of threads that run depth-first search in parallel, with work stealing
+	int thread_count = 1;
+};
+
 // get the max value expectation from current capacity and current undecided item
-auto get_expectation(const vector<Item> & items, int capacity, int start)
+// prefix sums of weight and value over the density-sorted items are built once, so that the critical item
+// (the first item that does not fit) is found with a binary search instead of a linear scan from start
+struct Expectation
+{
+	Expectation(const vector<Item> & _items): items(_items), prefix_weight(1, 0), prefix_value(1, 0)
+	{
+		for(auto & item : items)
+		{
+			prefix_weight.push_back(prefix_weight.back() + item.weight);
+			prefix_value.push_back(prefix_value.back() + item.value);
+		}
+	}
+
+	// the critical item of items [start, n) with the given capacity, items [start, critical) can be taken as a whole
+	int critical_item(int capacity, int start) const
+	{
+		auto target = prefix_weight[start] + capacity;
+		return upper_bound(prefix_weight.begin() + start, prefix_weight.end(), target) - prefix_weight.begin() - 1;
+	}
+
+	double operator() (int capacity, int start) const
+	{
+		if(capacity < 0) return 0.0;
+
+		auto target = prefix_weight[start] + capacity;
+		auto critical = critical_item(capacity, start);
+		auto expectation = static_cast<double>(prefix_value[critical] - prefix_value[start]);
+
+		// if current capacity is not enough to carry the whole critical item, then put a fraction of it into the knapsack
+		// and add the same fraction of its value to the expectation
+		if(critical < items.size())
+		{
+			auto item = items[critical];
+			expectation += static_cast<double>(item.value) * (target - prefix_weight[critical]) / item.weight;
+		}
+
+		return expectation;
+	}
+
+	// get the min value that has to be given up to free the given weight by removing items [0, end) fractionally,
+	// starting from end - 1, the lowest value density one
+	double loss(long long weight, int end) const
+	{
+		if(weight <= 0) return 0.0;
+		if(weight > prefix_weight[end]) return (numeric_limits<double>::max)();
+
+		// items [critical + 1, end) are removed as a whole
+		auto target = prefix_weight[end] - weight;
+		auto critical = upper_bound(prefix_weight.begin(), prefix_weight.begin() + end + 1, target) - prefix_weight.begin() - 1;
+		auto loss = static_cast<double>(prefix_value[end] - prefix_value[critical + 1]);
+
+		auto item = items[critical];
+		loss += static_cast<double>(item.value) * (prefix_weight[critical + 1] - target) / item.weight;
+
+		return loss;
+	}
+
+	const vector<Item> & items;
+	vector<long long> prefix_weight;
+	vector<long long> prefix_value;
+};
+
+// upper bound of value that can get with the left capacity from items [start, n), given as (capacity, start)
+using UpperBound = function<double(int, int)>;
+
+// the Dantzig bound, the value of the LP relaxation, which is what Expectation computes
+auto dantzig_bound(const Expectation & expectation) -> UpperBound
+{
+	return [&expectation](int capacity, int start) { return expectation(capacity, start); };
+}
+
+// the Martello-Toth bound U2, branch on the critical item of the LP relaxation:
+// U0: the critical item is not taken, the left capacity is filled at the value density of the next item
+// U1: the critical item is taken, the extra weight is given up at the value density of the previous item
+// U2 = max(U0, U1) is never above the Dantzig bound, and values are integral, so both parts can be rounded down
+auto martello_toth_bound(const Expectation & expectation) -> UpperBound
+{
+	return [&expectation](int capacity, int start)
+	{
+		if(capacity < 0) return 0.0;
+
+		auto & items = expectation.items;
+		auto critical = expectation.critical_item(capacity, start);
+		auto value = static_cast<double>(expectation.prefix_value[critical] - expectation.prefix_value[start]);
+		if(critical >= items.size()) return value;
+
+		auto left_capacity = static_cast<double>(expectation.prefix_weight[start] + capacity - expectation.prefix_weight[critical]);
+
+		auto u0 = value;
+		if(critical + 1 < items.size())
+		{
+			auto next = items[critical + 1];
+			u0 += floor(left_capacity * next.value / next.weight);
+		}
+
+		auto u1 = -(numeric_limits<double>::max)();
+		auto cur = items[critical];
+		if(critical > start && cur.weight <= capacity)
+		{
+			auto prev = items[critical - 1];
+			u1 = value + floor(cur.value - (cur.weight - left_capacity) * prev.value / prev.weight);
+		}
+
+		return max(u0, u1);
+	};
+}
+
+auto get_upper_bound(const Expectation & expectation, const string & name)
+{
+	return name == "mt" ? martello_toth_bound(expectation) : dantzig_bound(expectation);
+}
+
+// a node of the decision trail, it records the one item taken at it and the node it comes from
+// no-take decisions share the trail node of their parent, so only take decisions ever allocate
+struct TrailNode
+{
+	int parent;
+	int pos;
+
+	// number of search nodes and child trail nodes that still refer to this node
+	int refs;
+};
+
+// arena of trail nodes, released nodes are put into a free list and reused,
+// so memory is bounded by the number of live search nodes instead of the number of explored ones
+struct TrailPool
+{
+	// the empty trail, nothing is taken
+	static constexpr int root = -1;
+
+	int add(int parent, int pos)
+	{
+		acquire(parent);
+
+		auto node = TrailNode{ parent, pos, 1 };
+		if(free_list.empty())
+		{
+			nodes.push_back(node);
+			return static_cast<int>(nodes.size()) - 1;
+		}
+
+		auto i = free_list.back();
+		free_list.pop_back();
+		nodes[i] = node;
+		return i;
+	}
+
+	void acquire(int i)
+	{
+		if(i != root) ++nodes[i].refs;
+	}
+
+	void release(int i)
+	{
+		while(i != root && --nodes[i].refs == 0)
+		{
+			free_list.push_back(i);
+			i = nodes[i].parent;
+		}
+	}
+
+	// rebuild the full take/no-take vector by walking the parent links
+	void rebuild(int i, const vector<Item> & items, vector<int> & taken) const
+	{
+		fill(taken.begin(), taken.end(), 0);
+		for(; i != root; i = nodes[i].parent)
+		{
+			taken[items[nodes[i].pos].index] = 1;
+		}
+	}
+
+	vector<TrailNode> nodes;
+	vector<int> free_list;
+};
+
+// a search node includes 5 parts:
+// value:         value accumulated so far
+// capacity:      left capacity
+// expectation:   upper bound of value that can get with the left capacity
+// pos:           next item to consider
+// trail:         last node of the decision trail that leads here
+struct SearchNode
+{
+	double value;
+	int capacity;
+	double expectation;
+	int pos;
+	int trail;
+};
+
+// depth-first exploration, to prevent from stack-overflow, instead of using plain recursion here I maintain the stack myself
+struct DepthFirst
+{
+	void push(const SearchNode & node) { stack.push_back(node); }
+	SearchNode pop() { auto node = stack.back(); stack.pop_back(); return node; }
+	bool empty() const { return stack.empty(); }
+
+	vector<SearchNode> stack;
+};
+
+// best-first exploration, the node with the highest expectation is expanded first
+struct BestFirst
+{
+	struct Less
+	{
+		bool operator() (const SearchNode & lhs, const SearchNode & rhs) const
+		{
+			return lhs.expectation < rhs.expectation;
+		}
+	};
+
+	void push(const SearchNode & node) { queue.push(node); }
+	SearchNode pop() { auto node = queue.top(); queue.pop(); return node; }
+	bool empty() const { return queue.empty(); }
+
+	priority_queue<SearchNode, vector<SearchNode>, Less> queue;
+};
+
+// bounded-memory cache of the best value seen at each (pos, left capacity) state of branch and bound,
+// two paths that reach the same state have exactly the same subtree below it, so a node that arrives
+// with no more value than an earlier one is dominated and can be pruned at once
+// the table is split into buckets of a few entries each, when a bucket is full the entry of the deepest state is evicted,
+// since it stands for the smallest subtree and is the cheapest one to explore again
+struct TranspositionTable
+{
+	static constexpr int ways = 4;
+	static constexpr uint64_t empty = ~uint64_t(0);
+
+	struct Entry
+	{
+		uint64_t key;
+		long long value;
+	};
+
+	TranspositionTable(size_t memory_bytes): bucket_mask(0), hit_count(0), miss_count(0), eviction_count(0)
+	{
+		// round the bucket count down to a power of two, so that a bucket can be picked with a mask
+		auto bucket_count = memory_bytes / (ways * sizeof(Entry));
+		if(bucket_count == 0) return;
+		while(bucket_count & (bucket_count - 1)) bucket_count &= bucket_count - 1;
+
+		entries.assign(bucket_count * ways, Entry{ empty, 0 });
+		bucket_mask = bucket_count - 1;
+	}
+
+	bool enabled() const
+	{
+		return !entries.empty();
+	}
+
+	// return true if the state was already reached with no less value, otherwise record the value
+	bool dominated(int pos, int capacity, long long value)
+	{
+		auto key = (static_cast<uint64_t>(pos) << 32) | static_cast<uint32_t>(capacity);
+		auto bucket = entries.data() + ((key * 0x9E3779B97F4A7C15ull) >> 32 & bucket_mask) * ways;
+
+		auto victim = bucket;
+		for(auto i = 0; i < ways; ++i)
+		{
+			auto & entry = bucket[i];
+			if(entry.key == key)
+			{
+				if(entry.value >= value)
+				{
+					++hit_count;
+					return true;
+				}
+				++miss_count;
+				entry.value = value;
+				return false;
+			}
+
+			// prefer an empty slot, then the deepest state, positions are in the high bits of the key
+			if(victim->key != empty && (entry.key == empty || entry.key > victim->key)) victim = &entry;
+		}
+
+		++miss_count;
+		eviction_count += victim->key != empty;
+		*victim = Entry{ key, value };
+		return false;
+	}
+
+	vector<Entry> entries;
+	size_t bucket_mask;
+	long long hit_count;
+	long long miss_count;
+	long long eviction_count;
+};
+
+// find max value and the take/no-take choice for each item
+template<typename Frontier>
+auto search(const vector<Item> & items,  int capacity, const UpperBound & get_expectation, TranspositionTable & table)
+{
+	auto max_value = 0.0;
+	auto max_taken = vector<int>(items.size(), 0);
+
+	auto start_time = chrono::steady_clock::now();
+	auto node_count = 0LL;
+
+	TrailPool pool;
+	Frontier frontier;
+	frontier.push(SearchNode{ 0.0, capacity, get_expectation(capacity, 0), 0, TrailPool::root });
+	while(!frontier.empty())
+	{
+		auto cur = frontier.pop();
+		++node_count;
+
+		// if left capacity is not enough, or current expectation is smaller than the best value, then backtrack
+		if(cur.capacity < 0 || cur.expectation <= max_value)
+		{
+			pool.release(cur.trail);
+			continue;
+		}
+
+		// if max value is smaller than current value, update max value and rebuild its item-take choices
+		if(max_value < cur.value)
+		{
+			max_value = cur.value;
+			pool.rebuild(cur.trail, items, max_taken);
+		}
+
+		// if next item to consider dose not exist, or the same state was reached with no less value, then backtrack
+		if(cur.pos >= items.size() || (table.enabled() && table.dominated(cur.pos, cur.capacity, static_cast<long long>(cur.value))))
+		{
+			pool.release(cur.trail);
+			continue;
+		}
+
+		auto cur_item = items[cur.pos];
+
+		// try not to take the next item, it keeps the trail of current node
+		auto notake_value = cur.value;
+		auto notake_capacity = cur.capacity;
+		auto notake_expectation = notake_value + get_expectation(notake_capacity, cur.pos + 1);
+		pool.acquire(cur.trail);
+		frontier.push(SearchNode{ notake_value, notake_capacity, notake_expectation, cur.pos + 1, cur.trail });
+
+		// try to take the next item
+		auto take_value = cur.value + cur_item.value;
+		auto take_capacity = cur.capacity - cur_item.weight;
+		auto take_expectation = take_value + get_expectation(take_capacity, cur.pos + 1);
+		frontier.push(SearchNode{ take_value, take_capacity, take_expectation, cur.pos + 1, pool.add(cur.trail, cur.pos) });
+
+		pool.release(cur.trail);
+	}
+
+	auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	printf("[nodes %lld] [trail nodes %zu] [time %.3lfs] [nodes/sec %.0lf]\n", 
+			node_count, pool.nodes.size(), seconds, node_count / max(seconds, 1e-9));
+	if(table.enabled())
+	{
+		printf("[tt entries %zu] [tt hits %lld] [tt misses %lld] [tt evictions %lld]\n", 
+				table.entries.size(), table.hit_count, table.miss_count, table.eviction_count);
+	}
+
+	return make_tuple(static_cast<int>(max_value), max_taken);
+}
+
+// a unit of work that can move between threads: a search node, together with the positions of the items
+// taken on the way to it, since the trail pool of the thread that created the node is private to that thread
+struct Task
+{
+	SearchNode node;
+	vector<int> taken_pos;
+};
+
+// every thread owns one deque, the owner pushes and pops at the back, other threads steal from the front
+struct TaskDeque
+{
+	void push(Task task)
+	{
+		lock_guard<mutex> lock(m);
+		tasks.push_back(move(task));
+	}
+
+	bool pop(Task & task)
+	{
+		lock_guard<mutex> lock(m);
+		if(tasks.empty()) return false;
+		task = move(tasks.back());
+		tasks.pop_back();
+		return true;
+	}
+
+	bool steal(Task & task)
+	{
+		lock_guard<mutex> lock(m);
+		if(tasks.empty()) return false;
+		task = move(tasks.front());
+		tasks.pop_front();
+		return true;
+	}
+
+	bool empty()
+	{
+		lock_guard<mutex> lock(m);
+		return tasks.empty();
+	}
+
+	mutex m;
+	deque<Task> tasks;
+};
+
+// best solution found by any thread, the value is read without locking for pruning,
+// and is only changed together with the take/no-take choice under the mutex
+struct Incumbent
+{
+	Incumbent(int item_count): max_value(0), max_taken(item_count, 0) {}
+
+	template<typename Rebuild>
+	void update(int value, Rebuild rebuild)
+	{
+		lock_guard<mutex> lock(m);
+		if(value <= max_value.load()) return;
+		rebuild(max_taken);
+		max_value.store(value);
+	}
+
+	atomic<int> max_value;
+	vector<int> max_taken;
+	mutex m;
+};
+
+// find max value and the take/no-take choice for each item, with thread_count threads searching in parallel
+// each thread runs depth-first search on its own stack, and when some thread is idle it moves the shallowest node
+// of its stack (the largest unexplored subtree) to its deque, where idle threads can steal it from
+auto parallel_search(const vector<Item> & items, int capacity, const UpperBound & get_expectation, int thread_count)
+{
+	auto start_time = chrono::steady_clock::now();
+
+	auto incumbent = Incumbent(items.size());
+	auto deques = vector<TaskDeque>(thread_count);
+	auto node_count = vector<long long>(thread_count, 0);
+	auto steal_count = vector<long long>(thread_count, 0);
+
+	// number of tasks that are created but not finished yet, the search is over when it drops to 0
+	atomic<int> pending(1);
+	atomic<int> idle(0);
+
+	deques[0].push(Task{ SearchNode{ 0.0, capacity, get_expectation(capacity, 0), 0, TrailPool::root }, {} });
+
+	auto run = [&](int thread_id, Task & task)
+	{
+		TrailPool pool;
+		deque<SearchNode> stack;
+		stack.push_back(task.node);
+
+		// counted locally, so that threads do not keep writing to neighbouring counters
+		auto local_node_count = 0LL;
+
+		auto rebuild = [&](int trail, vector<int> & taken)
+		{
+			pool.rebuild(trail, items, taken);
+			for(auto pos : task.taken_pos)
+			{
+				taken[items[pos].index] = 1;
+			}
+		};
+
+		while(!stack.empty())
+		{
+			// share work only when someone is waiting for it, so that a busy thread pays almost nothing
+			if(local_node_count % 64 == 0 && stack.size() > 1 && idle.load() > 0 && deques[thread_id].empty())
+			{
+				auto shared = stack.front();
+				stack.pop_front();
+
+				auto taken_pos = task.taken_pos;
+				for(auto i = shared.trail; i != TrailPool::root; i = pool.nodes[i].parent)
+				{
+					taken_pos.push_back(pool.nodes[i].pos);
+				}
+				pool.release(shared.trail);
+				shared.trail = TrailPool::root;
+
+				++pending;
+				deques[thread_id].push(Task{ shared, move(taken_pos) });
+			}
+
+			auto cur = stack.back();
+			stack.pop_back();
+			++local_node_count;
+
+			// if left capacity is not enough, or current expectation is smaller than the best value, then backtrack
+			if(cur.capacity < 0 || cur.expectation <= incumbent.max_value.load(memory_order_relaxed))
+			{
+				pool.release(cur.trail);
+				continue;
+			}
+
+			if(incumbent.max_value.load(memory_order_relaxed) < cur.value)
+			{
+				incumbent.update(static_cast<int>(cur.value), [&](vector<int> & taken) { rebuild(cur.trail, taken); });
+			}
+
+			if(cur.pos >= items.size())
+			{
+				pool.release(cur.trail);
+				continue;
+			}
+
+			auto cur_item = items[cur.pos];
+
+			auto notake_expectation = cur.value + get_expectation(cur.capacity, cur.pos + 1);
+			pool.acquire(cur.trail);
+			stack.push_back(SearchNode{ cur.value, cur.capacity, notake_expectation, cur.pos + 1, cur.trail });
+
+			auto take_value = cur.value + cur_item.value;
+			auto take_capacity = cur.capacity - cur_item.weight;
+			auto take_expectation = take_value + get_expectation(take_capacity, cur.pos + 1);
+			stack.push_back(SearchNode{ take_value, take_capacity, take_expectation, cur.pos + 1, pool.add(cur.trail, cur.pos) });
+
+			pool.release(cur.trail);
+		}
+
+		node_count[thread_id] += local_node_count;
+	};
+
+	auto worker = [&](int thread_id)
+	{
+		auto generator = minstd_rand(thread_id + 1);
+		auto is_idle = false;
+		Task task;
+		while(pending.load() > 0)
+		{
+			auto found = deques[thread_id].pop(task);
+			for(auto i = 0; !found && i + 1 < thread_count; ++i)
+			{
+				auto victim = (thread_id + 1 + (generator() + i) % (thread_count - 1)) % thread_count;
+				found = deques[victim].steal(task);
+				steal_count[thread_id] += found;
+			}
+
+			if(!found)
+			{
+				if(!is_idle) ++idle;
+				is_idle = true;
+				this_thread::yield();
+				continue;
+			}
+
+			if(is_idle) --idle;
+			is_idle = false;
+
+			run(thread_id, task);
+			--pending;
+		}
+		if(is_idle) --idle;
+	};
+
+	vector<thread> threads;
+	for(auto i = 1; i < thread_count; ++i)
+	{
+		threads.push_back(thread(worker, i));
+	}
+	worker(0);
+	for(auto & t : threads)
+	{
+		t.join();
+	}
+
+	auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	auto total_node_count = 0LL;
+	for(auto i = 0; i < thread_count; ++i)
+	{
+		printf("[thread %-3d] [nodes %lld] [steals %lld]\n", i, node_count[i], steal_count[i]);
+		total_node_count += node_count[i];
+	}
+	printf("[nodes %lld] [time %.3lfs] [nodes/sec %.0lf]\n", total_node_count, seconds, total_node_count / max(seconds, 1e-9));
+
+	return make_tuple(incumbent.max_value.load(), incumbent.max_taken);
+}
+
+// bit-packed take/no-take table, row i holds the decision of the i-th item for every capacity
+struct DecisionTable
+{
+	DecisionTable(int _rows, int _cols): words_per_row((static_cast<size_t>(_cols) + 63) / 64), 
+		bits(static_cast<size_t>(_rows) * words_per_row, 0) {}
+
+	uint64_t * row(int i)
+	{
+		return bits.data() + i * words_per_row;
+	}
+
+	bool get(int i, int j) const
+	{
+		return (bits[i * words_per_row + j / 64] >> (j % 64)) & 1;
+	}
+
+	size_t words_per_row;
+	vector<uint64_t> bits;
+};
+
+// all threads wait here until every one of them arrives, then they are released together
+struct Barrier
+{
+	Barrier(int _count): count(_count), waiting(0), generation(0) {}
+
+	void wait()
+	{
+		unique_lock<mutex> lock(m);
+		auto cur_generation = generation;
+		if(++waiting == count)
+		{
+			waiting = 0;
+			++generation;
+			cv.notify_all();
+		}
+		else
+		{
+			cv.wait(lock, [&] { return cur_generation != generation; });
+		}
+	}
+
+	int count;
+	int waiting;
+	int generation;
+	mutex m;
+	condition_variable cv;
+};
+
+// merge one item into the capacity range [begin, end) of a dp row:
+// cur[c] = max(prev[c], prev[c - weight] + value), the take decision is set in take_bits when taking is strictly better
+// begin must be a multiple of 64, so that threads working on different ranges never write the same word of take_bits
+auto merge_row(const int * __restrict prev, int * __restrict cur, uint64_t * __restrict take_bits, 
+				int weight, int value, int begin, int end)
+{
+	auto c = begin;
+	for(; c < end && c < weight; ++c)
+	{
+		cur[c] = prev[c];
+	}
+
+	// scalar head, until c is aligned to the vector width
+	for(; c < end && c % 8 != 0; ++c)
+	{
+		auto take = prev[c - weight] + value;
+		auto better = take > prev[c];
+		cur[c] = better ? take : prev[c];
+		if(take_bits && better) take_bits[c / 64] |= uint64_t(1) << (c % 64);
+	}
+
+#if defined(__AVX2__)
+	auto value_vec = _mm256_set1_epi32(value);
+	for(; c + 8 <= end; c += 8)
+	{
+		auto notake = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(prev + c));
+		auto take = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(prev + c - weight)), value_vec);
+		auto better = _mm256_cmpgt_epi32(take, notake);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(cur + c), _mm256_max_epi32(take, notake));
+		if(take_bits) take_bits[c / 64] |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(better))) << (c % 64);
+	}
+#elif defined(__SSE2__)
+	auto value_vec = _mm_set1_epi32(value);
+	for(; c + 4 <= end; c += 4)
+	{
+		auto notake = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + c));
+		auto take = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + c - weight)), value_vec);
+		auto better = _mm_cmpgt_epi32(take, notake);
+		// SSE2 has no 32-bit integer max, blend with the comparison mask instead
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(cur + c), _mm_or_si128(_mm_and_si128(better, take), _mm_andnot_si128(better, notake)));
+		if(take_bits) take_bits[c / 64] |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(better))) << (c % 64);
+	}
+#endif
+
+	// scalar tail, also the whole loop when no vector instruction set is available
+	for(; c < end; ++c)
+	{
+		auto take = prev[c - weight] + value;
+		auto better = take > prev[c];
+		cur[c] = better ? take : prev[c];
+		if(take_bits && better) take_bits[c / 64] |= uint64_t(1) << (c % 64);
+	}
+}
+
+// run the capacity-indexed dp over items [begin, end), and return the last row,
+// where row[c] is the max value that can be achieved with capacity c
+// if table is given, the take decision of item i is written to row i - begin of the table
+// the capacity range of each row is split into chunks, one chunk for each thread, and threads meet at a barrier after each item
+auto dp_rows(const vector<Item> & items, int begin, int end, int capacity, int thread_count, DecisionTable * table)
+{
+	auto prev = vector<int>(capacity + 1, 0);
+	auto cur = vector<int>(capacity + 1, 0);
+
+	auto chunk = (capacity + thread_count) / thread_count;
+	chunk = (chunk + 63) / 64 * 64;
+
+	auto barrier = Barrier(thread_count);
+	auto worker = [&](int thread_id)
+	{
+		auto chunk_begin = min(capacity + 1, thread_id * chunk);
+		auto chunk_end = min(capacity + 1, chunk_begin + chunk);
+
+		auto prev_row = prev.data();
+		auto cur_row = cur.data();
+		for(auto i = begin; i < end; ++i)
+		{
+			auto take_bits = table ? table->row(i - begin) : nullptr;
+			merge_row(prev_row, cur_row, take_bits, items[i].weight, items[i].value, chunk_begin, chunk_end);
+			swap(prev_row, cur_row);
+			barrier.wait();
+		}
+	};
+
+	vector<thread> threads;
+	for(auto i = 1; i < thread_count; ++i)
+	{
+		threads.push_back(thread(worker, i));
+	}
+	worker(0);
+	for(auto & t : threads)
+	{
+		t.join();
+	}
+
+	// rows are swapped after every item, so the last row is in prev
+	if((end - begin) % 2 == 1) swap(prev, cur);
+	return prev;
+}
+
+// find the take/no-take choice for items [begin, end) that achieves the max value within capacity,
+// with only O(capacity) memory: the best split of the capacity between the two halves of the items
+// is found from two dp rows, then each half is solved recursively with its share of the capacity
+auto dp_recompute(const vector<Item> & items, int begin, int end, int capacity, int thread_count, vector<int> & taken) -> void
+{
+	if(begin >= end || capacity <= 0) return;
+
+	if(end - begin == 1)
+	{
+		if(items[begin].weight <= capacity && items[begin].value > 0) taken[items[begin].index] = 1;
+		return;
+	}
+
+	auto mid = (begin + end) / 2;
+	auto best_split = 0;
+	{
+		auto left = dp_rows(items, begin, mid, capacity, thread_count, nullptr);
+		auto right = dp_rows(items, mid, end, capacity, thread_count, nullptr);
+
+		auto best_value = -1;
+		for(auto c = 0; c <= capacity; ++c)
+		{
+			if(best_value < left[c] + right[capacity - c])
+			{
+				best_value = left[c] + right[capacity - c];
+				best_split = c;
+			}
+		}
+	}
+
+	dp_recompute(items, begin, mid, best_split, thread_count, taken);
+	dp_recompute(items, mid, end, capacity - best_split, thread_count, taken);
+}
+
+// find max value and the take/no-take choice for each item with dynamic programming
+auto dp_search(const vector<Item> & items, int capacity, const Options & options)
 {
-	auto expectation = 0.0;
-	for(auto i = start; i < items.size(); ++i)
+	auto item_count = static_cast<int>(items.size());
+	auto taken = vector<int>(items.size(), 0);
+
+	if(options.traceback == "recompute")
 	{
-		auto item = items[i];
-		if(capacity >= item.weight)
+		dp_recompute(items, 0, item_count, capacity, options.thread_count, taken);
+
+		auto value = 0;
+		for(auto & item : items)
 		{
-			expectation += item.value;
-			capacity -= item.weight;
+			if(taken[item.index]) value += item.value;
 		}
-		// if current capacity is not enough to carry the whole item, then put a fraction of it into the knapsack
-		// and add the same fraction of its value to the expectation
-		else
+		return make_tuple(value, taken);
+	}
+
+	auto table = DecisionTable(item_count, capacity + 1);
+	auto row = dp_rows(items, 0, item_count, capacity, options.thread_count, &table);
+
+	// walk the table backward, from the last item and the full capacity
+	auto cur_capacity = capacity;
+	for(auto i = item_count - 1; i >= 0; --i)
+	{
+		if(table.get(i, cur_capacity))
+		{
+			taken[items[i].index] = 1;
+			cur_capacity -= items[i].weight;
+		}
+	}
+
+	return make_tuple(row[capacity], taken);
+}
+
+// a state of the expanding core: the break solution changed by some of the decisions on the core items
+// weight can exceed the capacity, since removing more items later may make it feasible again
+struct CoreState
+{
+	long long weight;
+	long long value;
+	int trail;
+};
+
+// merge two state lists that are sorted by weight, dropping every state that is dominated by a lighter (or equally heavy)
+// state with no less value, so that the result is sorted by weight with strictly increasing value
+auto merge_states(const vector<CoreState> & a, const vector<CoreState> & b, vector<CoreState> & merged, TrailPool & pool)
+{
+	merged.clear();
+	auto i = 0;
+	auto j = 0;
+	while(i < a.size() || j < b.size())
+	{
+		auto from_a = j >= b.size() || (i < a.size() && (a[i].weight < b[j].weight || (a[i].weight == b[j].weight && a[i].value >= b[j].value)));
+		auto state = from_a ? a[i++] : b[j++];
+
+		if(!merged.empty() && merged.back().value >= state.value)
+		{
+			pool.release(state.trail);
+			continue;
+		}
+		merged.push_back(state);
+	}
+}
+
+// the weights that some subset of items [begin, end) adds up to, as a bitset over 0..capacity,
+// each item shifts the bitset by its weight and ors it in, 64 weights per word
+auto subset_sums(const vector<Item> & items, int begin, int end, int capacity)
+{
+	auto word_count = capacity / 64 + 1;
+	auto bits = vector<uint64_t>(word_count, 0);
+	bits[0] = 1;
+
+	for(auto i = begin; i < end; ++i)
+	{
+		auto weight = items[i].weight;
+		if(weight > capacity) continue;
+
+		// from the top word down, so that every word reads the bitset from before this item
+		auto shift = weight / 64;
+		auto offset = weight % 64;
+		for(auto w = word_count - 1; w >= shift; --w)
+		{
+			auto moved = bits[w - shift] << offset;
+			if(offset > 0 && w - shift > 0) moved |= bits[w - shift - 1] >> (64 - offset);
+			bits[w] |= moved;
+		}
+	}
+
+	// clear the sums past the capacity in the last word
+	if(capacity % 64 != 63) bits[word_count - 1] &= (uint64_t(1) << (capacity % 64 + 1)) - 1;
+	return bits;
+}
+
+auto has_sum(const vector<uint64_t> & bits, int weight)
+{
+	return (bits[weight / 64] >> (weight % 64) & 1) != 0;
+}
+
+// take a subset of items [begin, end) that weighs exactly target, which has to exist, in O(capacity) memory:
+// the target is split between the two halves of the items by their subset sums, and each half is solved recursively
+auto subset_sum_recompute(const vector<Item> & items, int begin, int end, int target, vector<int> & taken) -> void
+{
+	if(target == 0) return;
+
+	if(end - begin == 1)
+	{
+		taken[items[begin].index] = 1;
+		return;
+	}
+
+	auto mid = (begin + end) / 2;
+	auto split = 0;
+	{
+		auto left = subset_sums(items, begin, mid, target);
+		auto right = subset_sums(items, mid, end, target);
+		while(!has_sum(left, split) || !has_sum(right, target - split)) ++split;
+	}
+
+	subset_sum_recompute(items, begin, mid, split, taken);
+	subset_sum_recompute(items, mid, end, target - split, taken);
+}
+
+// when every item has the same value density, a solution is as good as it is heavy, so the best one is the heaviest
+// subset sum within the capacity, found with bitsets in O(n capacity / 64) time, whatever the number of states would be
+auto subset_sum_search(const vector<Item> & items, int capacity)
+{
+	auto start_time = chrono::steady_clock::now();
+	auto item_count = static_cast<int>(items.size());
+	auto taken = vector<int>(item_count, 0);
+
+	auto best_weight = capacity;
+	{
+		auto sums = subset_sums(items, 0, item_count, capacity);
+		while(!has_sum(sums, best_weight)) --best_weight;
+	}
+	subset_sum_recompute(items, 0, item_count, best_weight, taken);
+
+	auto value = 0;
+	for(auto & item : items)
+	{
+		if(taken[item.index]) value += item.value;
+	}
+
+	auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	printf("[subset sum] [weight %d] [time %.3lfs]\n", best_weight, seconds);
+
+	return make_tuple(value, taken);
+}
+
+// find max value and the take/no-take choice for each item with an expanding core, in the manner of Pisinger's minknap
+// the search starts from the break solution, where every item before the critical item is taken, and grows a core around
+// the critical item one item at a time: items on the right may be added, items on the left may be removed
+// the non-dominated states of the core are kept as a list, and states whose bound can not beat the best value are dropped,
+// the search is over when no state is left, or as soon as the best value reaches the LP bound of the whole instance,
+// so only the part of the items near the critical item is ever looked at
+auto core_search(const vector<Item> & items, int capacity, const Expectation & get_expectation)
+{
+	auto start_time = chrono::steady_clock::now();
+	auto item_count = static_cast<int>(items.size());
+
+	// with equal value densities every bound is the same, nothing can be pruned, and the states grow to every subset sum
+	auto equal_density = all_of(items.begin(), items.end(), [&](const Item & item)
+	{
+		return static_cast<long long>(item.value) * items[0].weight == static_cast<long long>(items[0].value) * item.weight;
+	});
+	if(item_count > 0 && equal_density) return subset_sum_search(items, capacity);
+
+	// critical item, the first one that does not fit
+	auto critical = 0;
+	auto break_weight = 0LL;
+	auto break_value = 0LL;
+	while(critical < item_count && break_weight + items[critical].weight <= capacity)
+	{
+		break_weight += items[critical].weight;
+		break_value += items[critical].value;
+		++critical;
+	}
+
+	TrailPool pool;
+	auto best_value = break_value;
+	auto best_trail = TrailPool::root;
+
+	vector<CoreState> states = { CoreState{ break_weight, break_value, TrailPool::root } };
+	vector<CoreState> shifted;
+	vector<CoreState> merged;
+
+	// next item to add is right, next item to remove is left
+	auto left = critical - 1;
+	auto right = critical;
+	auto max_state_count = states.size();
+	auto add_next = true;
+	auto lp_bound = static_cast<long long>(floor(get_expectation(capacity, 0) + 1e-6));
+	while(!states.empty() && (left >= 0 || right < item_count) && best_value < lp_bound)
+	{
+		// expand the core by one item, alternating between the two sides while both have items left
+		auto add = right < item_count && (add_next || left < 0);
+		auto pos = add ? right++ : left--;
+		auto sign = add ? 1 : -1;
+		add_next = !add;
+
+		shifted.clear();
+		for(auto & state : states)
+		{
+			shifted.push_back(CoreState{ state.weight + sign * items[pos].weight, state.value + sign * items[pos].value, pool.add(state.trail, pos) });
+		}
+		merge_states(states, shifted, merged, pool);
+		swap(states, merged);
+
+		// the items outside the core bound how much a state can still improve, every item on the left is denser
+		// than any item on the right, so swapping them never pays off in the LP relaxation:
+		// a feasible state can at best fill the left capacity with the items on the right,
+		// an overweight state must at least give up the extra weight from the items on the left
+		auto kept = 0;
+		for(auto & state : states)
+		{
+			if(state.weight <= capacity && state.value > best_value)
+			{
+				pool.acquire(state.trail);
+				pool.release(best_trail);
+				best_value = state.value;
+				best_trail = state.trail;
+			}
+
+			auto bound = state.weight <= capacity ? 
+							state.value + get_expectation(capacity - state.weight, right) : 
+							state.value - get_expectation.loss(state.weight - capacity, left + 1);
+
+			if(bound < best_value + 1 - 1e-6)
+			{
+				pool.release(state.trail);
+				continue;
+			}
+			states[kept++] = state;
+		}
+		states.resize(kept);
+		max_state_count = max(max_state_count, states.size());
+	}
+
+	// the best solution is the break solution with the decisions on its trail flipped
+	auto taken = vector<int>(item_count, 0);
+	for(auto i = 0; i < critical; ++i)
+	{
+		taken[items[i].index] = 1;
+	}
+	for(auto i = best_trail; i != TrailPool::root; i = pool.nodes[i].parent)
+	{
+		taken[items[pool.nodes[i].pos].index] ^= 1;
+	}
+
+	auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	printf("[core items %d] [max states %zu] [trail nodes %zu] [time %.3lfs]\n", 
+			right - left - 1, max_state_count, pool.nodes.size(), seconds);
+
+	return make_tuple(static_cast<int>(best_value), taken);
+}
+
+// find max value and the take/no-take choice for each item with the sparse dp of Nemhauser and Ullmann
+// instead of a row over every capacity, only the non-dominated (weight, value) states are kept, as a list sorted by weight,
+// and each item is merged into it with a linear two-pointer sweep, states that do not fit or whose bound can not beat
+// the best value are dropped, so time and memory depend on the number of states and not on the capacity
+auto pareto_search(const vector<Item> & items, int capacity, const Expectation & get_expectation)
+{
+	auto start_time = chrono::steady_clock::now();
+	auto item_count = static_cast<int>(items.size());
+
+	TrailPool pool;
+
+	// start from the greedy solution, so that pruning works from the first item
+	auto best_value = 0LL;
+	auto best_trail = TrailPool::root;
+	auto left_capacity = capacity;
+	for(auto i = 0; i < item_count; ++i)
+	{
+		if(items[i].weight > left_capacity) continue;
+
+		left_capacity -= items[i].weight;
+		best_value += items[i].value;
+		auto trail = pool.add(best_trail, i);
+		pool.release(best_trail);
+		best_trail = trail;
+	}
+
+	vector<CoreState> states = { CoreState{ 0, 0, TrailPool::root } };
+	vector<CoreState> shifted;
+	vector<CoreState> merged;
+	auto max_state_count = states.size();
+	auto total_state_count = 0LL;
+
+	for(auto i = 0; i < item_count && !states.empty(); ++i)
+	{
+		shifted.clear();
+		for(auto & state : states)
+		{
+			if(state.weight + items[i].weight > capacity) break;
+			shifted.push_back(CoreState{ state.weight + items[i].weight, state.value + items[i].value, pool.add(state.trail, i) });
+		}
+		merge_states(states, shifted, merged, pool);
+		swap(states, merged);
+
+		auto kept = 0;
+		for(auto & state : states)
+		{
+			if(state.value > best_value)
+			{
+				pool.acquire(state.trail);
+				pool.release(best_trail);
+				best_value = state.value;
+				best_trail = state.trail;
+			}
+
+			if(state.value + get_expectation(capacity - state.weight, i + 1) < best_value + 1 - 1e-6)
+			{
+				pool.release(state.trail);
+				continue;
+			}
+			states[kept++] = state;
+		}
+		states.resize(kept);
+
+		max_state_count = max(max_state_count, states.size());
+		total_state_count += states.size();
+	}
+
+	auto taken = vector<int>(item_count, 0);
+	pool.rebuild(best_trail, items, taken);
+
+	auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	printf("[max states %zu] [total states %lld] [trail nodes %zu] [time %.3lfs]\n", 
+			max_state_count, total_state_count, pool.nodes.size(), seconds);
+
+	return make_tuple(static_cast<int>(best_value), taken);
+}
+
+// find a take/no-take choice whose value is at least (1 - epsilon) of the max value, in O(n^2 / epsilon) time
+// item values are scaled down by K = epsilon * LB / n, where LB is a lower bound of the max value, and a dp indexed by
+// scaled value finds the min weight of each scaled value, rounding loses less than K per item, so less than epsilon * LB in total
+// since the max value is at most twice LB, the scaled values never go beyond 2 * n / epsilon
+auto fptas_search(const vector<Item> & items, int capacity, const Expectation & get_expectation, double epsilon)
+{
+	auto start_time = chrono::steady_clock::now();
+	auto item_count = static_cast<int>(items.size());
+	auto taken = vector<int>(item_count, 0);
+
+	// lower bound, the better of the greedy solution and the most valuable single item that fits
+	auto greedy_value = 0LL;
+	auto max_item_value = 0LL;
+	auto left_capacity = capacity;
+	for(auto & item : items)
+	{
+		if(item.weight > capacity) continue;
+		max_item_value = max(max_item_value, static_cast<long long>(item.value));
+
+		if(item.weight > left_capacity) continue;
+		left_capacity -= item.weight;
+		greedy_value += item.value;
+	}
+
+	auto lower_bound = max(greedy_value, max_item_value);
+	if(lower_bound == 0) return make_tuple(0, taken);
+
+	// values are integral, so there is nothing to gain from a scale below 1
+	auto scale = max(1.0, epsilon * lower_bound / item_count);
+	auto scaled_value = vector<int>(item_count, 0);
+	for(auto i = 0; i < item_count; ++i)
+	{
+		scaled_value[i] = items[i].weight > capacity ? 0 : static_cast<int>(items[i].value / scale);
+	}
+	auto max_scaled_value = static_cast<int>(get_expectation(capacity, 0) / scale);
+
+	// min_weight[q] is the min weight that achieves scaled value q, updated in place from high q to low q,
+	// so that min_weight[q - v] still holds the value before the current item
+	auto infinity = (numeric_limits<long long>::max)() / 2;
+	auto min_weight = vector<long long>(max_scaled_value + 1, infinity);
+	min_weight[0] = 0;
+
+	auto table = DecisionTable(item_count, max_scaled_value + 1);
+	for(auto i = 0; i < item_count; ++i)
+	{
+		auto v = scaled_value[i];
+		auto w = items[i].weight;
+		if(v == 0 || w > capacity) continue;
+
+		auto take_bits = table.row(i);
+		for(auto q = max_scaled_value; q >= v; --q)
+		{
+			if(min_weight[q - v] + w < min_weight[q])
+			{
+				min_weight[q] = min_weight[q - v] + w;
+				take_bits[q / 64] |= uint64_t(1) << (q % 64);
+			}
+		}
+	}
+
+	auto best_q = 0;
+	for(auto q = max_scaled_value; q >= 0; --q)
+	{
+		if(min_weight[q] <= capacity)
 		{
-			expectation += static_cast<double>(item.value) * capacity / item.weight;
+			best_q = q;
 			break;
 		}
 	}
 
-	return expectation;
+	// walk the table backward, from the last item and the best scaled value
+	auto value = 0;
+	for(auto i = item_count - 1, q = best_q; i >= 0; --i)
+	{
+		if(table.get(i, q))
+		{
+			taken[items[i].index] = 1;
+			value += items[i].value;
+			q -= scaled_value[i];
+		}
+	}
+
+	auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	printf("[epsilon %g] [scale %.3lf] [max scaled value %d] [value / upper bound %.6lf] [time %.3lfs]\n", 
+			epsilon, scale, max_scaled_value, value / max(get_expectation(capacity, 0), 1.0), seconds);
+
+	return make_tuple(value, taken);
 }
 
-// find max value and the take/no-take choice for each item
-auto search(const vector<Item> & items,  int capacity)
+// the smaller problem left after preprocessing, and what is needed to map its solution back to the original items
+struct Reduction
 {
-	auto max_value = 0.0;
-	auto max_taken = vector<int>(items.size(), 0);
+	// undecided items in value density decreasing order, with index renumbered to 0..core.size()-1
+	vector<Item> core;
+	int capacity;
 
-	// to prevent from stack-overflow, instead of using plain recursion here I maintain the stack myself
-	// a stack element includes 5 parts:
-	// value:         value accumulated so far
-	// capacity:      left capacity
-	// expectation:   upper bound of value that can get with the left capacity
-	// taken:         current take/no-take choice of each item
-	// pos:           next item to consider
-
-	auto start_value = 0.0;
-	auto start_capacity = capacity;
-	auto start_expectation = get_expectation(items, capacity, 0);
-	auto start_taken = vector<int>(items.size(), 0);
-	auto start_pos = 0;
-
-	using StackElem = tuple<double, int, double, vector<int>, int>;
-	vector<StackElem> stack;
-	stack.push_back(make_tuple(start_value, start_capacity, start_expectation, start_taken, start_pos));
-	while(!stack.empty())
-	{
-		auto [cur_value, cur_capacity, cur_expectation, cur_taken, cur_pos] = stack.back();
-		stack.pop_back();
-
-		// if left capacity is not enough, then backtrack
-		if(cur_capacity < 0) continue;
-		
-		// if current expectation is smaller than the best value, then backtrack
-		if(cur_expectation <= max_value) continue;
-
-		// if max value is smaller than current value, update max value and its item-take choices
-		if(max_value < cur_value)
-		{
-			max_value = cur_value;
-			max_taken = cur_taken;
-		}
-
-		// if next item to consider dose not exist, then backtrack
-		if(cur_pos >= items.size()) continue;
-
-		auto cur_item = items[cur_pos];
-    
-		// try not to take the next item
-        auto notake_value = cur_value;
-        auto notake_capacity = cur_capacity;
-        auto notake_expectation = notake_value + get_expectation(items, notake_capacity, cur_pos + 1);
-        auto notake_taken = cur_taken;
-        
-        stack.push_back(make_tuple(notake_value, notake_capacity, notake_expectation, notake_taken, cur_pos + 1));
-    
-		// try to take the next item
-        auto take_value = cur_value + cur_item.value;
-        auto take_capacity = cur_capacity - cur_item.weight;
-        auto take_expectation = take_value + get_expectation(items, take_capacity, cur_pos + 1);
-        auto take_taken = cur_taken;
-        take_taken[cur_item.index] = 1;
-        
-        stack.push_back(make_tuple(take_value, take_capacity, take_expectation, take_taken, cur_pos + 1));
+	// original index of each core item
+	vector<int> core_index;
+
+	// value and take/no-take choice of the fixed items, indexed by original index
+	int fixed_value;
+	vector<int> fixed_taken;
+
+	// the greedy solution, used as incumbent while fixing, and kept in case it is better than anything in the core
+	int greedy_value;
+	vector<int> greedy_taken;
+
+	// combine the solution of the core with the fixed items
+	auto expand(int core_value, const vector<int> & core_taken) const
+	{
+		if(greedy_value >= fixed_value + core_value) return make_tuple(greedy_value, greedy_taken);
+
+		auto taken = fixed_taken;
+		for(auto i = 0; i < core_taken.size(); ++i)
+		{
+			if(core_taken[i]) taken[core_index[i]] = 1;
+		}
+		return make_tuple(fixed_value + core_value, taken);
 	}
-	return make_tuple(static_cast<int>(max_value), max_taken);
+};
+
+// shrink the problem before searching, items must be sorted in value density decreasing order
+// 1. items heavier than the capacity are left out
+// 2. a greedy pass gives an incumbent
+// 3. with the critical density r, any solution is bounded by the LP bound U minus |value - r * weight| for every item
+//    that it decides differently from the LP, if that is no better than the incumbent, the LP decision is fixed
+// 4. an item is dropped when it can not be taken together with all the items that dominate it (not heavier, not less valuable):
+//    in some optimal solution, an item is only taken if all its dominating items are taken, otherwise they could be swapped
+auto reduce(const vector<Item> & items, int capacity, bool enabled)
+{
+	auto item_count = static_cast<int>(items.size());
+
+	Reduction reduction;
+	reduction.capacity = capacity;
+	reduction.fixed_value = 0;
+	reduction.fixed_taken = vector<int>(item_count, 0);
+	reduction.greedy_value = 0;
+	reduction.greedy_taken = vector<int>(item_count, 0);
+
+	vector<Item> candidates;
+	for(auto & item : items)
+	{
+		if(item.weight <= capacity) candidates.push_back(item);
+	}
+
+	if(!enabled) candidates = items;
+
+	// greedy pass, take every item that still fits in density order
+	auto left_capacity = capacity;
+	for(auto & item : candidates)
+	{
+		if(item.weight > left_capacity) continue;
+
+		left_capacity -= item.weight;
+		reduction.greedy_value += item.value;
+		reduction.greedy_taken[item.index] = 1;
+	}
+
+	// critical item, the first one that does not fit in the LP relaxation
+	auto critical = 0;
+	auto lp_weight = 0LL;
+	while(critical < candidates.size() && lp_weight + candidates[critical].weight <= capacity)
+	{
+		lp_weight += candidates[critical].weight;
+		++critical;
+	}
+
+	// 0: fixed to no-take, 1: fixed to take, -1: undecided
+	auto decision = vector<int>(candidates.size(), -1);
+	auto fixed_count = 0;
+	if(enabled && critical < candidates.size())
+	{
+		auto density = static_cast<double>(candidates[critical].value) / candidates[critical].weight;
+		auto upper_bound = Expectation(candidates)(capacity, 0);
+		auto threshold = reduction.greedy_value + 1 - 1e-6;
+
+		for(auto i = 0; i < candidates.size(); ++i)
+		{
+			if(i == critical) continue;
+
+			auto reduced_cost = candidates[i].value - density * candidates[i].weight;
+			if(upper_bound - abs(reduced_cost) < threshold)
+			{
+				decision[i] = i < critical;
+				++fixed_count;
+			}
+		}
+	}
+
+	for(auto i = 0; i < candidates.size(); ++i)
+	{
+		if(decision[i] != 1) continue;
+
+		reduction.capacity -= candidates[i].weight;
+		reduction.fixed_value += candidates[i].value;
+		reduction.fixed_taken[candidates[i].index] = 1;
+	}
+
+	// dominance among undecided items, an item is dominated by the ones that are lighter or more valuable,
+	// identical items are ordered by position, so that two items never dominate each other
+	auto dominated_count = 0;
+	if(enabled)
+	{
+		vector<int> free;
+		for(auto i = 0; i < candidates.size(); ++i)
+		{
+			if(decision[i] == -1) free.push_back(i);
+		}
+
+		auto dominates = [&](int j, int i)
+		{
+			auto a = candidates[j];
+			auto b = candidates[i];
+			if(a.weight == b.weight && a.value == b.value) return j < i;
+			return a.weight <= b.weight && a.value >= b.value;
+		};
+
+		for(auto i : free)
+		{
+			auto dominating_weight = static_cast<long long>(candidates[i].weight);
+			for(auto j : free)
+			{
+				if(j == i || !dominates(j, i)) continue;
+
+				dominating_weight += candidates[j].weight;
+				if(dominating_weight > reduction.capacity) break;
+			}
+
+			if(dominating_weight > reduction.capacity)
+			{
+				decision[i] = 0;
+				++dominated_count;
+			}
+		}
+	}
+
+	for(auto i = 0; i < candidates.size(); ++i)
+	{
+		if(decision[i] != -1) continue;
+
+		auto item = candidates[i];
+		reduction.core_index.push_back(item.index);
+		item.index = static_cast<int>(reduction.core.size());
+		reduction.core.push_back(item);
+	}
+
+	if(enabled)
+	{
+		printf("[reduce] [items %d -> %zu] [capacity %d -> %d] [too heavy %d] [fixed %d] [dominated %d] [greedy value %d]\n", 
+				item_count, reduction.core.size(), capacity, reduction.capacity, 
+				item_count - static_cast<int>(candidates.size()), fixed_count, dominated_count, reduction.greedy_value);
+	}
+
+	return reduction;
 }
 
 // print the content of a vector
@@ -144,40 +1455,173 @@ auto load_item(const char * filename)
 	return make_tuple(items, capacity);
 }
 
-auto save_item(const char * filename, int value, const vector<int> & taken)
+auto save_item(const char * filename, int value, const vector<int> & taken, int optimal = 1)
 {
 	// write result to cpp_output.txt, so that solver.py can read result from it
 	auto f = fopen(filename, "w");
 	assert(f);
 
-	fprintf(f, "%d 1\n", value);
+	fprintf(f, "%d %d\n", value, optimal);
 	print_vec(taken, f);
 	fclose(f);
 }
 
+// run the engine selected by the command line options
+auto solve(const vector<Item> & items, int capacity, const Expectation & expectation, const Options & options)
+{
+	if(options.engine == "dp") return dp_search(items, capacity, options);
+	if(options.engine == "core") return core_search(items, capacity, expectation);
+	if(options.engine == "pareto") return pareto_search(items, capacity, expectation);
+	if(options.engine == "fptas") return fptas_search(items, capacity, expectation, options.epsilon);
+
+	auto bound = get_upper_bound(expectation, options.bound);
+	if(options.thread_count > 1) return parallel_search(items, capacity, bound, options.thread_count);
+
+	auto table = TranspositionTable(options.table_mb << 20);
+	if(options.order == "best") return search<BestFirst>(items, capacity, bound, table);
+	return search<DepthFirst>(items, capacity, bound, table);
+}
+
+auto print_usage()
+{
+	printf("Usage: ./main <data-file> [--engine=bb|dp|core|pareto|fptas] [--epsilon=E] [--order=depth|best] [--bound=dantzig|mt] [--tt-mb=N] [--traceback=table|recompute] [--reduce=on|off] [--threads=N]\n");
+	printf("Example: ./main data/ks_30_0\n");
+	printf("Example: ./main data/ks_10000_0 --engine=dp --threads=8\n");
+	printf("Example: ./main data/ks_400_0 --threads=8\n");
+}
+
+auto parse_options(int argc, char * argv[])
+{
+	Options options;
+	auto table_given = false;
+	for(auto i = 1; i < argc; ++i)
+	{
+		auto arg = argv[i];
+		auto value = strchr(arg, '=');
+
+		if(strncmp(arg, "--", 2) != 0)
+		{
+			options.data_file = arg;
+		}
+		else if(value && strncmp(arg, "--engine=", 9) == 0)
+		{
+			options.engine = value + 1;
+		}
+		else if(value && strncmp(arg, "--epsilon=", 10) == 0)
+		{
+			options.epsilon = atof(value + 1);
+		}
+		else if(value && strncmp(arg, "--order=", 8) == 0)
+		{
+			options.order = value + 1;
+		}
+		else if(value && strncmp(arg, "--bound=", 8) == 0)
+		{
+			options.bound = value + 1;
+		}
+		else if(value && strncmp(arg, "--tt-mb=", 8) == 0)
+		{
+			options.table_mb = max(0, atoi(value + 1));
+			table_given = true;
+		}
+		else if(value && strncmp(arg, "--traceback=", 12) == 0)
+		{
+			options.traceback = value + 1;
+		}
+		else if(value && strncmp(arg, "--reduce=", 9) == 0)
+		{
+			options.reduce = strcmp(value + 1, "off") != 0;
+		}
+		else if(value && strncmp(arg, "--threads=", 10) == 0)
+		{
+			options.thread_count = max(1, atoi(value + 1));
+		}
+		else
+		{
+			printf("Unknown option: %s\n", arg);
+			print_usage();
+			exit(-1);
+		}
+	}
+
+	if(!options.data_file)
+	{
+		print_usage();
+		exit(-1);
+	}
+
+	if(options.engine != "bb" && options.engine != "dp" && options.engine != "core" && options.engine != "pareto" && options.engine != "fptas")
+	{
+		printf("Unknown engine: %s\n", options.engine.c_str());
+		exit(-1);
+	}
+
+	if(options.order != "depth" && options.order != "best")
+	{
+		printf("Unknown order: %s\n", options.order.c_str());
+		exit(-1);
+	}
+
+	if(options.engine == "fptas" && (options.epsilon <= 0 || options.epsilon >= 1))
+	{
+		printf("Epsilon must be in (0, 1)\n");
+		exit(-1);
+	}
+
+	if(options.bound != "dantzig" && options.bound != "mt")
+	{
+		printf("Unknown bound: %s\n", options.bound.c_str());
+		exit(-1);
+	}
+
+	if(options.engine == "bb" && options.order == "best" && options.thread_count > 1)
+	{
+		printf("Best-first order runs on one thread only\n");
+		exit(-1);
+	}
+
+	// the workers of the parallel search do not share a transposition table
+	if(options.engine == "bb" && table_given && options.thread_count > 1)
+	{
+		printf("The transposition table runs on one thread only\n");
+		exit(-1);
+	}
+
+	if(options.traceback != "table" && options.traceback != "recompute")
+	{
+		printf("Unknown traceback: %s\n", options.traceback.c_str());
+		exit(-1);
+	}
+
+	return options;
+}
+
 int main(int argc, char * argv[])
 {
-    if(argc < 2)
-    {
-        printf("Usage: ./main <data-file>\n");
-        printf("Example: ./main data/ks_30_0\n");
-        exit(-1);
-    }
+	auto options = parse_options(argc, argv);
 
 	// you can change this line to try different input
 	// but when submiting, makesure you are reading from python_input.txt
 	
-	auto [items, capacity] = load_item(argv[1]);
+	auto [items, capacity] = load_item(options.data_file);
 
 	// sort the items, so that they are in value density decreasing order
 	sort(items.begin(), items.end());
 
-	auto [value, taken] = search(items, capacity);
+	// only the undecided core goes to the solver, its solution is mapped back to the original items
+	auto reduction = reduce(items, capacity, options.reduce);
+	auto expectation = Expectation(reduction.core);
+
+	auto [core_value, core_taken] = solve(reduction.core, reduction.capacity, expectation, options);
+	auto [value, taken] = reduction.expand(core_value, core_taken);
+
+	// only the approximation can not prove its value is the max value
+	auto optimal = options.engine == "fptas" ? 0 : 1;
 
-	printf("%d 1\n", value);
+	printf("%d %d\n", value, optimal);
 	print_vec(taken);
 
-	save_item("cpp_output.txt", value, taken);
+	save_item("cpp_output.txt", value, taken, optimal);
 
 	return 0;
 }
@@ -0,0 +1,45 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Run the island guided local search with 1, 2, 4, 8 and 16 threads on one instance for a fixed wall time, and report
+# the best distance reached at a few points in time, so that the speedup of the island model can be read off. e.g.
+# python benchmark.py data/tsp_33810_1 60 --exchange=500
+
+import re
+import subprocess
+import sys
+
+THREADS = [1, 2, 4, 8, 16]
+CHECKPOINTS = [0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 30, 60, 120, 300, 600]
+
+def run(data_file, seconds, thread_count, extra_args):
+    command = ['./main', data_file, '--threads=%d' % thread_count, '--time=%g' % seconds] + extra_args
+    output = subprocess.run(command, stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+    # best distance vs wall time, one point per improvement of the shared best tour
+    curve = [(float(t), float(d)) for t, d in re.findall(r'\[time ([\d.]+)s\] \[island +\d+ *\] \[best distance ([\d.]+)\]', output)]
+    match = re.search(r'\[init \w+\] \[time [\d.]+s\] \[distance ([\d.]+)\]', output)
+    start_distance = float(match.group(1)) if match else float('nan')
+    return start_distance, curve
+
+def best_at(start_distance, curve, t):
+    best = start_distance
+    for time, distance in curve:
+        if time > t:
+            break
+        best = distance
+    return best
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print('Usage: python benchmark.py <data-file> <seconds> [main options]')
+        sys.exit(-1)
+
+    data_file, seconds, extra_args = sys.argv[1], float(sys.argv[2]), sys.argv[3:]
+    checkpoints = [t for t in CHECKPOINTS if t < seconds] + [seconds]
+
+    print('%-10s' % 'threads' + ''.join('%-16s' % ('%gs' % t) for t in checkpoints))
+    for thread_count in THREADS:
+        start_distance, curve = run(data_file, seconds, thread_count, extra_args)
+        print('%-10d' % thread_count + ''.join('%-16.2f' % best_at(start_distance, curve, t) for t in checkpoints))
+        sys.stdout.flush()
@@ -0,0 +1,49 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Compare the 2-opt and the Lin-Kernighan style local search inside the guided local search on time-to-target:
+# 2-opt runs for a fixed wall time on every instance in data, the best distance it reaches is the target, and the time
+# each move needs to reach that target is reported. Extra arguments are passed to main, e.g.
+# python benchmark_move.py 30 --or-opt=off
+
+import os
+import re
+import subprocess
+import sys
+
+MOVES = ['2opt', 'lk']
+
+def instance_size(filename):
+    with open(os.path.join('data', filename), 'r') as f:
+        return int(f.readline().split()[0])
+
+def run(filename, move, seconds, extra_args):
+    command = ['./main', os.path.join('data', filename), '--move=' + move, '--time=%g' % seconds] + extra_args
+    output = subprocess.run(command, stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+    # best distance vs wall time, one point per improvement of the best tour
+    return [(float(t), float(d)) for t, d in re.findall(r'\[time ([\d.]+)s\] \[island +\d+ *\] \[best distance ([\d.]+)\]', output)]
+
+def time_to_target(curve, target):
+    for time, distance in curve:
+        if distance <= target + 1e-6:
+            return '%.3fs' % time
+    return '-'
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('Usage: python benchmark_move.py <seconds> [main options]')
+        sys.exit(-1)
+
+    seconds, extra_args = float(sys.argv[1]), sys.argv[2:]
+    instances = sorted((f for f in os.listdir('data') if f.startswith('tsp_')), key=instance_size)
+
+    print('%-16s%-18s' % ('instance', 'target') + ''.join('%-12s' % (move + ' time') for move in MOVES))
+    for filename in instances:
+        curves = { move: run(filename, move, seconds, extra_args) for move in MOVES }
+        if not curves['2opt']:
+            continue
+
+        target = curves['2opt'][-1][1]
+        print('%-16s%-18.2f' % (filename, target) + ''.join('%-12s' % time_to_target(curves[move], target) for move in MOVES))
+        sys.stdout.flush()
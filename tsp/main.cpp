@@ -10,443 +10,3220 @@
 #include<vector>
 #include<random>
 #include<cmath>
-#include<functional>
+#include<chrono>
 #include<limits>
 #include<cassert>
+#include<cstring>
+#include<cstdint>
+#include<cstdlib>
+#include<algorithm>
+#include<array>
+#include<numeric>
+#include<queue>
+#include<tuple>
+#include<ctime>
+#include<string>
+#include<thread>
+#include<atomic>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include<immintrin.h>
+#endif
 
 using namespace std;
-using DistanceMatrix = function<double(int, int)>;
 
 struct Node
 {
     double x, y;
 };
 
-struct Connection
+// the tour is kept as an array of nodes in visiting order, together with the position of every node in it,
+// so that next, prev and between are O(1), a 2-opt move reverses one path of the tour, and since reversing either side
+// gives the same cycle, the shorter side is always the one reversed, which touches at most n / 2 nodes
+struct Tour
 {
-    int in;
-    int out;
-};
-
-
-struct Penalty
-{
-    Penalty(int node_count)
+    Tour(const vector<int> & _order): order(_order), pos(_order.size())
     {
-        for(auto i = 1; i <= node_count; ++i)
+        for(auto i = 0; i < order.size(); ++i)
         {
-            penalty.push_back(vector<int>(i, 0));
+            pos[order[i]] = i;
         }
     }
 
-    int & operator() (int i, int j)
+    int size() const
     {
-        if(j > i) swap(i, j);
-        return penalty[i][j];
+        return static_cast<int>(order.size());
     }
 
-    const int & operator() (int i, int j) const
+    int next(int a) const
     {
-        if(j > i) swap(i, j);
-        return penalty[i][j];
+        auto i = pos[a] + 1;
+        return order[i == size() ? 0 : i];
     }
 
-    vector<vector<int>> penalty;
-};
-
-struct Activate
-{
-    Activate(int _size): bits(_size, 1), ones(_size) {}
-
-    void set_1(int i)
+    int prev(int a) const
     {
-        ones += bits[i] == 0;
-        bits[i] = 1;
+        auto i = pos[a];
+        return order[i == 0 ? size() - 1 : i - 1];
     }
 
-    void set_0(int i)
+    // whether b is on the path from a to c, following next
+    bool between(int a, int b, int c) const
     {
-        ones -= bits[i] == 1;
-        bits[i] = 0;
+        auto pa = pos[a], pb = pos[b], pc = pos[c];
+        return pa <= pc ? pa <= pb && pb <= pc : pb >= pa || pb <= pc;
     }
 
-    int get(int i) const
+    // reverse the path from a to b, following next
+    void reverse(int a, int b)
     {
-        return bits[i];
-    }
+        auto length = (pos[b] - pos[a] + size()) % size() + 1;
+        if(2 * length > size())
+        {
+            // reverse the other side instead, from next(b) to prev(a)
+            auto c = next(b);
+            b = prev(a);
+            a = c;
+            length = size() - length;
+        }
 
-    size_t size() const
-    {
-        return bits.size();
+        auto i = pos[a];
+        auto j = pos[b];
+        for(auto k = 0; k < length / 2; ++k)
+        {
+            swap(order[i], order[j]);
+            pos[order[i]] = i;
+            pos[order[j]] = j;
+
+            i = i + 1 == size() ? 0 : i + 1;
+            j = j == 0 ? size() - 1 : j - 1;
+        }
     }
 
-    vector<int> bits;
-    int ones;
+    vector<int> order;
+    vector<int> pos;
 };
 
-auto print_tour(const vector<Connection> & connection, FILE * f = stdout)
+// command line options, each of them is given in the form of "--name=value"
+struct Options
 {
-    auto node = 0;
-    for(auto i = 0; i < connection.size(); ++i)
-    {
-        fprintf(f, "%d", node);
-        fprintf(f, i + 1 == connection.size() ? "\n" : " ");
-        node = connection[node].out;
-    }
-}
+    const char * data_file = nullptr;
 
-auto get_distance_matrix(const vector<Node> & node_vec)
-{
-    auto square = [](double x) { return x * x; };
-    auto distance = [square](Node a, Node b) { return sqrt(square(a.x - b.x) + square(a.y - b.y)); };
-    auto distance_matrix = [&node_vec, distance](int i, int j) { return distance(node_vec[i], node_vec[j]); };
-    return distance_matrix;
-}
+    // number of nearest neighbors kept as t3/t4 candidates of each node, 0 to scan every node
+    int neighbor_count = 10;
+
+    // number of guided local search steps
+    int step_limit = 1000000;
 
+    // how distances are looked up, euclid: computed from double coordinates, float: computed from float coordinates,
+    // matrix: full precomputed matrix
+    string distance = "euclid";
 
-auto init_connection(int node_count, DistanceMatrix distance_matrix)
+    // order in which active nodes are searched, queue: FIFO work queue of active nodes, sweep: sweep all nodes by index
+    string activation = "queue";
+
+    // construction heuristic of the starting tour, nn: nearest neighbor with a k-d tree, greedy: greedy edge matching,
+    // sfc: Hilbert space-filling curve order, scan: nearest neighbor by scanning every node (O(n^2))
+    string init = "nn";
+
+    // number of guided local search islands run in parallel, each on its own thread
+    int thread_count = 1;
+
+    // every exchange_interval steps, an island whose best tour is worse than the shared best tour restarts from it
+    int exchange_interval = 1000;
+
+    // wall time limit in seconds, 0 for no limit
+    double time_limit = 0;
+
+    // compute a Held-Karp lower bound on a background thread, and report the optimality gap of the best tour
+    bool bound = false;
+
+    // stop once the best tour is within this percentage of the lower bound, 0 to never stop on the gap
+    double target_gap = 0;
+
+    // backbone mode: number of independent trials whose final tours vote for the fixed edges, 0 for none
+    int backbone_count = 0;
+
+    // backbone mode: number of guided local search steps of each trial
+    int backbone_steps = 100000;
+
+    // backbone mode: comma-separated result files of earlier runs, whose tours vote along with the trials
+    string backbone_files;
+
+    // decomposition mode: number of nodes in each sub-path, 0 to search the whole tour at once
+    int partition_size = 0;
+
+    // decomposition mode: number of rounds, the cuts between sub-paths move after each round
+    int partition_rounds = 10;
+
+    // decomposition mode: number of guided local search steps on each sub-path in each round
+    int partition_steps = 1000;
+
+    // local search move, 2opt: best 2-opt move from the candidate lists, lk: Lin-Kernighan style variable-depth move
+    string move = "2opt";
+
+    // max number of 2-opt flips chained in one lk move
+    int lk_depth = 10;
+
+    // relocate segments of 1 to 3 nodes (Or-opt) when no 2-opt move improves
+    bool or_opt = true;
+
+    // number of consecutive nodes in each window of the exact window optimizer run after the search, 0 to skip it
+    int window_size = 0;
+
+    // kernel of the batch gain evaluation, auto: the widest one the cpu supports, avx512, avx2 or scalar
+    string simd = "auto";
+
+    // report the moves evaluated per second with each distance policy, instead of solving
+    bool benchmark = false;
+};
+
+// 2-d tree over the nodes, each range [lo, hi) of index is split at its median mid along axis[mid],
+// the nodes closer to the origin of that axis go to [lo, mid), the others go to [mid + 1, hi)
+struct KdTree
 {
-    vector<int> tour;
-    for(auto i = 0; i < node_count; ++i)
+    KdTree(const vector<Node> & _node_vec): node_vec(_node_vec), index(_node_vec.size()), axis(_node_vec.size(), 0), 
+        alive(_node_vec.size(), 0), where(_node_vec.size()), removed(_node_vec.size(), 0)
     {
-        tour.push_back(i);
+        iota(index.begin(), index.end(), 0);
+        build(0, static_cast<int>(index.size()));
+        for(auto i = 0; i < index.size(); ++i) where[index[i]] = i;
     }
 
-    for(auto i = 0; i + 1 < tour.size(); ++i)
+    static double coordinate(Node node, int axis)
     {
-        auto min_distance = (numeric_limits<double>::max)();
-        auto min_distance_node = -1;
-        
-        for(auto j = i + 1; j < tour.size(); ++j)
-        {
-            auto distance = distance_matrix(tour[i], tour[j]);
-            if(min_distance > distance)
-            {
-                min_distance = distance;
-                min_distance_node = j;
-            }
-        }
-        swap(tour[i + 1], tour[min_distance_node]);
+        return axis == 0 ? node.x : node.y;
     }
 
-    vector<Connection> connection(node_count);
-    for (auto i = 0; i < tour.size(); ++i)
+    // split along the axis with the larger spread, so that cells stay roughly square
+    void build(int lo, int hi)
     {
-        auto node = tour[i];
-        auto next_node = tour[(i + 1) % tour.size()];
-        connection[node].out = next_node;
-        connection[next_node].in = node;
-    }
-    return connection;
-}
-
+        if(lo >= hi) return;
+        alive[(lo + hi) / 2] = hi - lo;
+        if(hi - lo == 1) return;
 
-// random sample from a vector
-template<typename T>
-T random_sample(const vector<T> & vec)
-{
-	assert(!vec.empty());
-
-	static default_random_engine generator(time(nullptr));
-	uniform_int_distribution<size_t> distribution(0, vec.size() - 1);
-	auto random_index = distribution(generator);
+        auto min_x = (numeric_limits<double>::max)(), max_x = -min_x;
+        auto min_y = min_x, max_y = max_x;
+        for(auto i = lo; i < hi; ++i)
+        {
+            auto node = node_vec[index[i]];
+            min_x = min(min_x, node.x);
+            max_x = max(max_x, node.x);
+            min_y = min(min_y, node.y);
+            max_y = max(max_y, node.y);
+        }
 
-	return vec[random_index];
-}
+        auto mid = (lo + hi) / 2;
+        auto split_axis = max_x - min_x >= max_y - min_y ? 0 : 1;
+        nth_element(index.begin() + lo, index.begin() + mid, index.begin() + hi, [&](int a, int b) 
+        {
+            return coordinate(node_vec[a], split_axis) < coordinate(node_vec[b], split_axis);
+        });
+        axis[mid] = split_axis;
 
+        build(lo, mid);
+        build(mid + 1, hi);
+    }
 
-// swap two edges, with four vertexes: t1, t2, t3, t4
-// before swapping, the two edges are: t1 -> t2, t3 -> t4
-// after swapping, the two edges are: t1 -> t3, t2 -> t4
+    // k nearest nodes of node i, closest first, node i itself is excluded
+    vector<int> nearest(int i, int k) const
+    {
+        // max-heap of squared distance, the farthest of the k nodes found so far is on top
+        priority_queue<tuple<double, int>> heap;
+        search(0, static_cast<int>(index.size()), i, k, heap);
 
+        vector<int> result(heap.size());
+        for(auto j = static_cast<int>(heap.size()) - 1; j >= 0; --j)
+        {
+            result[j] = get<1>(heap.top());
+            heap.pop();
+        }
+        return result;
+    }
 
-auto select_t3_t4(int t1, int t2, const vector<Connection> & connection, DistanceMatrix distance_matrix, 
-                            const Penalty & penalty, double lambda)
-{
-    auto max_gain = -(numeric_limits<double>::max)();
-    auto t4_candidate = vector<int>();
-    auto t2_out = connection[t2].out;
-    for(auto i = 0; i < connection.size(); ++i)
+    void search(int lo, int hi, int i, int k, priority_queue<tuple<double, int>> & heap) const
     {
-        auto t4 = i;
-        auto t3 = connection[t4].in;
+        if(lo >= hi) return;
 
-        if(t4 == t1 || t4 == t2 || t4 == t2_out) continue;
+        auto mid = (lo + hi) / 2;
+        auto node = index[mid];
+        auto p = node_vec[i];
+        auto q = node_vec[node];
 
-        auto d12 = distance_matrix(t1, t2);
-        auto d34 = distance_matrix(t3, t4);
-        auto d13 = distance_matrix(t1, t3);
-        auto d24 = distance_matrix(t2, t4);
-
-        auto p12 = penalty(t1, t2);
-        auto p34 = penalty(t3, t4);
-        auto p13 = penalty(t1, t3);
-        auto p24 = penalty(t2, t4);
+        if(node != i)
+        {
+            auto d = (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y);
+            if(heap.size() < k) heap.push(make_tuple(d, node));
+            else if(d < get<0>(heap.top()))
+            {
+                heap.pop();
+                heap.push(make_tuple(d, node));
+            }
+        }
 
-        auto gain = (d12 + lambda * p12) + (d34 + lambda * p34) - (d13 + lambda * p13) - (d24 + lambda * p24);
+        // search the side of the split that holds node i first, the other side only if it can still hold a closer node
+        auto diff = coordinate(p, axis[mid]) - coordinate(q, axis[mid]);
+        if(diff < 0) search(lo, mid, i, k, heap);
+        else search(mid + 1, hi, i, k, heap);
 
-        if(max_gain < gain)
+        if(heap.size() < k || diff * diff < get<0>(heap.top()))
         {
-            max_gain = gain;
-            t4_candidate.clear();
-            t4_candidate.push_back(t4);
+            if(diff < 0) search(mid + 1, hi, i, k, heap);
+            else search(lo, mid, i, k, heap);
         }
-        else if(max_gain == gain)
+    }
+
+    // take node i out of nearest_alive queries, the alive counts on the path from the root down to it are decremented
+    void remove(int i)
+    {
+        if(removed[i]) return;
+        removed[i] = 1;
+
+        auto lo = 0, hi = static_cast<int>(index.size());
+        while(true)
         {
-            t4_candidate.push_back(t4);
+            auto mid = (lo + hi) / 2;
+            --alive[mid];
+            if(mid == where[i]) break;
+            if(where[i] < mid) hi = mid;
+            else lo = mid + 1;
         }
     }
 
-    if(max_gain > 1e-6)
+    // the closest node to p that has not been removed, -1 if every node has been removed
+    int nearest_alive(Node p) const
     {
-        auto t4 = random_sample(t4_candidate);
-        auto t3 = connection[t4].in;
-
-        return make_tuple(t3, t4);
+        auto best = -1;
+        auto best_d = (numeric_limits<double>::max)();
+        search_alive(0, static_cast<int>(index.size()), p, best, best_d);
+        return best;
     }
 
-    return make_tuple(-1, -1);
-}
+    void search_alive(int lo, int hi, Node p, int & best, double & best_d) const
+    {
+        // subtrees without alive nodes are skipped, so the query stays O(log n) while the tree empties
+        if(lo >= hi || alive[(lo + hi) / 2] == 0) return;
 
+        auto mid = (lo + hi) / 2;
+        auto node = index[mid];
+        auto q = node_vec[node];
 
+        if(!removed[node])
+        {
+            auto d = (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y);
+            if(d < best_d)
+            {
+                best_d = d;
+                best = node;
+            }
+        }
 
-auto swap_edge(int t1, int t2, int t3, int t4, vector<Connection> & connection, DistanceMatrix distance_matrix, 
-                const Penalty & penalty, double & distance, double & augmented_distance, double lambda)
-{
-    auto cur_node = t2;
-    auto cur_node_out = connection[cur_node].out;
+        auto diff = coordinate(p, axis[mid]) - coordinate(q, axis[mid]);
+        if(diff < 0) search_alive(lo, mid, p, best, best_d);
+        else search_alive(mid + 1, hi, p, best, best_d);
 
-    while(cur_node != t3)
-    {
-        auto next_cur_node = cur_node_out;
-        auto next_cur_node_out = connection[next_cur_node].out;
+        if(diff * diff < best_d)
+        {
+            if(diff < 0) search_alive(mid + 1, hi, p, best, best_d);
+            else search_alive(lo, mid, p, best, best_d);
+        }
+    }
 
+    const vector<Node> & node_vec;
+    vector<int> index;
+    vector<int> axis;
 
-        connection[cur_node].in = cur_node_out;
-        connection[cur_node_out].out = cur_node;
+    // number of alive nodes in the subtree whose split node is at this position of index
+    vector<int> alive;
+    // position of each node in index
+    vector<int> where;
+    vector<char> removed;
+};
 
-        cur_node = next_cur_node;
-        cur_node_out = next_cur_node_out;
+// the k nearest neighbors of every node, stored row by row, k = 0 means no candidate list is used
+struct NeighborList
+{
+    const int * begin(int i) const
+    {
+        return neighbors.data() + static_cast<size_t>(i) * k;
     }
 
-    connection[t2].out = t4;
-    connection[t4].in = t2;
-
-    connection[t1].out = t3;
-    connection[t3].in = t1;
+    const int * end(int i) const
+    {
+        return begin(i) + k;
+    }
 
-    auto d12 = distance_matrix(t1, t2);
-    auto d34 = distance_matrix(t3, t4);
-    auto d13 = distance_matrix(t1, t3);
-    auto d24 = distance_matrix(t2, t4);
+    int k;
+    vector<int> neighbors;
+};
 
-    auto p12 = penalty(t1, t2);
-    auto p34 = penalty(t3, t4);
-    auto p13 = penalty(t1, t3);
-    auto p24 = penalty(t2, t4);
 
-    auto gain = (d12 + lambda * p12) + (d34 + lambda * p34) - (d13 + lambda * p13) - (d24 + lambda * p24);
+// penalty of every edge, almost all of them stay 0, since only a few tour edges are penalized in each round,
+// so instead of a triangular n * n table, the penalized edges are kept in two places:
+// each node has a few inline slots for the edges to its higher-numbered partners, which covers the hot edges,
+// and the rest go to an open-addressing hash table keyed by the packed edge id
+// both lookups are O(1), and memory grows with the number of penalized edges
+struct Penalty
+{
+    static constexpr int inline_count = 2;
+    static constexpr uint64_t empty = ~uint64_t(0);
 
-    distance -= d12 + d34 - d13 - d24;
-    augmented_distance -= gain;
-}
+    struct Slot
+    {
+        int partner;
+        int value;
+    };
 
-auto add_penalty(const vector<Connection> & connection, DistanceMatrix distance_matrix, Penalty & penalty, Activate & activate, 
-                    double & augmented_distance, double lambda)
-{
-    auto max_util = -(numeric_limits<double>::max)();
-    vector<int> max_util_node;
+    Penalty(int node_count): slots(static_cast<size_t>(node_count) * inline_count, Slot{ -1, 0 }), 
+        overflow(node_count, 0), keys(16, empty), values(16, 0), hash_count(0) {}
 
-    for(auto i = 0; i < connection.size(); ++i)
+    int operator() (int i, int j) const
     {
-        auto i_out = connection[i].out;
-        auto d = distance_matrix(i, i_out);
-        auto p = (1 + penalty(i, i_out));
-        auto util = d / (1 + p);
+        if(j < i) swap(i, j);
 
-        if(max_util < util)
+        auto slot = slots.data() + static_cast<size_t>(i) * inline_count;
+        for(auto k = 0; k < inline_count; ++k)
         {
-            max_util = util;
-            max_util_node.clear();
-            max_util_node.push_back(i);
+            if(slot[k].partner == j) return slot[k].value;
         }
-        else if(max_util == util)
+        if(overflow[i] == 0) return 0;
+
+        auto key = edge_key(i, j);
+        for(auto h = hash(key); ; h = (h + 1) & (keys.size() - 1))
         {
-            max_util_node.push_back(i);
+            if(keys[h] == key) return values[h];
+            if(keys[h] == empty) return 0;
         }
     }
 
-    for(auto i : max_util_node)
+    // increase the penalty of edge (i, j) by one
+    void add(int i, int j)
     {
-        auto i_out = connection[i].out;
-        ++penalty(i, i_out);
+        if(j < i) swap(i, j);
 
-        activate.set_1(i);
-        activate.set_1(i_out);
+        auto slot = slots.data() + static_cast<size_t>(i) * inline_count;
+        for(auto k = 0; k < inline_count; ++k)
+        {
+            if(slot[k].partner == j)
+            {
+                ++slot[k].value;
+                return;
+            }
+        }
 
-        augmented_distance += lambda;
+        if(overflow[i] == 0)
+        {
+            for(auto k = 0; k < inline_count; ++k)
+            {
+                if(slot[k].partner != -1) continue;
+                slot[k] = Slot{ j, 1 };
+                return;
+            }
+        }
+
+        // keep the load factor under 1/2, so that probe sequences stay short
+        if(2 * (hash_count + 1) > keys.size()) grow();
+
+        auto key = edge_key(i, j);
+        auto h = hash(key);
+        while(keys[h] != key && keys[h] != empty) h = (h + 1) & (keys.size() - 1);
+        if(keys[h] == empty)
+        {
+            keys[h] = key;
+            ++hash_count;
+            ++overflow[i];
+        }
+        ++values[h];
     }
-}
 
-auto total_distance(const vector<Connection> & connection, DistanceMatrix distance_matrix)
-{
-    auto dis = 0.0;
-    for(auto i = 0; i < connection.size(); ++i)
+    static uint64_t edge_key(int i, int j)
     {
-        dis += distance_matrix(i, connection[i].out);
+        return (static_cast<uint64_t>(i) << 32) | static_cast<uint32_t>(j);
     }
 
-    return dis;
-}
-
-auto total_augmented_distance(const vector<Connection> & connection, DistanceMatrix distance_matrix, const Penalty & penalty, double lambda)
-{
-    auto augmented_dis = 0.0;
-    for(auto i = 0; i < connection.size(); ++i)
+    size_t hash(uint64_t key) const
     {
-        auto i_out = connection[i].out;
-        auto d = distance_matrix(i, i_out);
-        auto p = penalty(i, i_out);
-        augmented_dis += d + p * lambda;
+        return (key * 0x9E3779B97F4A7C15ull) >> 20 & (keys.size() - 1);
     }
 
-    return augmented_dis;
-}
+    void grow()
+    {
+        auto old_keys = move(keys);
+        auto old_values = move(values);
+        keys.assign(old_keys.size() * 2, empty);
+        values.assign(old_values.size() * 2, 0);
 
+        for(auto k = 0; k < old_keys.size(); ++k)
+        {
+            if(old_keys[k] == empty) continue;
 
-auto save_result(const char * filename, double distance, const vector<Connection> & connection)
-{
-    auto f = fopen(filename, "w");
+            auto h = hash(old_keys[k]);
+            while(keys[h] != empty) h = (h + 1) & (keys.size() - 1);
+            keys[h] = old_keys[k];
+            values[h] = old_values[k];
+        }
+    }
 
-    fprintf(f, "%lf 0\n", distance);
-    print_tour(connection, f);
+    vector<Slot> slots;
 
-    fclose(f);
-}
+    // number of edges of each node that live in the hash table
+    vector<int> overflow;
 
-auto load_node(const char * filename)
-{
-    auto f = fopen(filename, "r");
+    vector<uint64_t> keys;
+    vector<int> values;
+    size_t hash_count;
+};
 
-    int node_count;
-    fscanf(f, "%d", &node_count);
+// indexed max-heap of the utilities d / (1 + p) of the tour edges, so that a penalty round finds the edges with max
+// utility without scanning the whole tour, the moves and the penalty increments keep it up to date edge by edge
+// the heap holds edge ids, each node knows the ids of its (at most two) tour edges, and each id knows its heap position
+struct UtilityHeap
+{
+    UtilityHeap(int node_count): edge_of(node_count, { -1, -1 }) {}
 
-    vector<Node> node_vec;
-    for(auto i = 0; i < node_count; ++i)
+    int find(int a, int b) const
     {
-        Node p;
-        fscanf(f, "%lf %lf", &p.x, &p.y);
-        node_vec.push_back(p);
+        for(auto id : edge_of[a])
+        {
+            if(id != -1 && (ends[id][0] == b || ends[id][1] == b)) return id;
+        }
+        assert(false);
+        return -1;
     }
-    fclose(f);
-
-    return node_vec;
-}
-
-auto init_lambda(const vector<Connection> & connection, DistanceMatrix distance_matrix, double alpha)
-{
-    return alpha * total_distance(connection, distance_matrix) / connection.size();
-}
-
-auto search(const vector<Connection> & connection, DistanceMatrix distance_matrix)
-{
-    auto step_limit = 1000000;
-
-    auto penalty = Penalty(connection.size());
-    auto alpha = 0.1;
-    auto lambda = 0.0;
-
-    auto activate = Activate(connection.size());
 
-    auto current_connection = connection;
-    auto current_distance = total_distance(current_connection, distance_matrix);
-    auto current_augmented_distance = total_augmented_distance(current_connection, distance_matrix, penalty, lambda);
-
-    auto best_connection = current_connection;
-    auto best_distance = current_distance;
-
-    for (auto cur_step = 0; cur_step < step_limit; ++cur_step)
+    void add(int a, int b, double util)
     {
-        printf("[step %-8d] [current distance %lf] [current augmented distance %lf] [best distance %lf]\n", 
-                cur_step + 1, current_distance, current_augmented_distance, best_distance);
-        
-        while(activate.ones > 0)
+        auto id = static_cast<int>(ends.size());
+        if(free_ids.empty())
         {
-            for(auto bit = 0; bit < activate.size(); ++bit)
-            {
-                if(!activate.get(bit)) continue;
+            ends.push_back({ a, b });
+            utils.push_back(util);
+            where.push_back(0);
+        }
+        else
+        {
+            id = free_ids.back();
+            free_ids.pop_back();
+            ends[id] = { a, b };
+            utils[id] = util;
+        }
 
-                auto bit_in = current_connection[bit].in;
-                auto bit_out = current_connection[bit].out;
+        *find_slot(a, -1) = id;
+        *find_slot(b, -1) = id;
 
-                auto t1_t2_candidate = vector<tuple<int, int>>{ make_tuple(bit_in, bit), make_pair(bit, bit_out) };
+        where[id] = static_cast<int>(heap.size());
+        heap.push_back(id);
+        sift_up(where[id]);
+    }
 
-                for(auto j = 0; j < t1_t2_candidate.size(); ++j)
-                {
-                    auto [t1, t2] = t1_t2_candidate[j];
+    void remove(int a, int b)
+    {
+        auto id = find(a, b);
+        *find_slot(a, id) = -1;
+        *find_slot(b, id) = -1;
+        free_ids.push_back(id);
+
+        auto h = where[id];
+        auto last = heap.back();
+        heap.pop_back();
+        if(last == id) return;
+
+        heap[h] = last;
+        where[last] = h;
+        sift_up(h);
+        sift_down(where[last]);
+    }
 
-                    auto [t3, t4] = select_t3_t4(t1, t2, current_connection, distance_matrix, penalty, lambda);
+    void update(int a, int b, double util)
+    {
+        auto id = find(a, b);
+        utils[id] = util;
+        sift_up(where[id]);
+        sift_down(where[id]);
+    }
 
-                    if(t3 == -1)
-                    {
-                        if(j == 1)
-                        {
-                            activate.set_0(bit);
-                        }
-                        continue;
-                    }
-                    
+    // the edges whose utility equals the max, the entries equal to the max form a subtree at the root
+    void max_edges(vector<tuple<int, int>> & edges) const
+    {
+        edges.clear();
+        if(heap.empty()) return;
 
-                    swap_edge(t1, t2, t3, t4, current_connection, distance_matrix, penalty, current_distance, current_augmented_distance, lambda);
-                    
-                    activate.set_1(t1);
-                    activate.set_1(t2);
-                    activate.set_1(t3);
-                    activate.set_1(t4);
+        auto max_util = utils[heap[0]];
+        vector<int> stack(1, 0);
+        while(!stack.empty())
+        {
+            auto h = stack.back();
+            stack.pop_back();
+            if(h >= heap.size() || utils[heap[h]] != max_util) continue;
 
-                    break;
-                }
+            edges.push_back(make_tuple(ends[heap[h]][0], ends[heap[h]][1]));
+            stack.push_back(2 * h + 1);
+            stack.push_back(2 * h + 2);
+        }
+    }
 
-                if (best_distance > current_distance)
-                {
-                    best_connection = current_connection;
-                    best_distance = current_distance;
+    int * find_slot(int node, int id)
+    {
+        return edge_of[node][0] == id ? &edge_of[node][0] : &edge_of[node][1];
+    }
 
-                    save_result("cpp_output.txt", best_distance, best_connection);
-                }
-            }
+    void swap_entries(int h1, int h2)
+    {
+        swap(heap[h1], heap[h2]);
+        where[heap[h1]] = h1;
+        where[heap[h2]] = h2;
+    }
+
+    void sift_up(int h)
+    {
+        while(h > 0 && utils[heap[(h - 1) / 2]] < utils[heap[h]])
+        {
+            swap_entries(h, (h - 1) / 2);
+            h = (h - 1) / 2;
         }
-        if(lambda == 0.0) lambda = init_lambda(connection, distance_matrix, alpha);
-        add_penalty(current_connection, distance_matrix, penalty, activate, current_augmented_distance, lambda);
     }
 
-    save_result("cpp_output.txt", best_distance, best_connection);
-    return best_connection;
-}
+    void sift_down(int h)
+    {
+        auto size = static_cast<int>(heap.size());
+        while(2 * h + 1 < size)
+        {
+            auto child = 2 * h + 1;
+            if(child + 1 < size && utils[heap[child]] < utils[heap[child + 1]]) ++child;
+            if(utils[heap[child]] <= utils[heap[h]]) break;
+            swap_entries(h, child);
+            h = child;
+        }
+    }
 
+    vector<int> heap;
+    vector<array<int, 2>> edge_of;
 
+    // per edge id: its two nodes, its utility and its position in heap
+    vector<array<int, 2>> ends;
+    vector<double> utils;
+    vector<int> where;
+    vector<int> free_ids;
+};
 
+// the nodes whose neighborhood still has to be searched, the ones with their don't-look bit off
+// next() gives the node to search next, a node that leads to an improving move is activated again with set_1,
+// a node that leads to none is inactivated with set_0
 
-int main(int argc, char * argv[])
+// the original order: sweep the nodes by index over and over, skipping inactive ones,
+// so every sweep touches all n nodes, no matter how few of them are active
+struct SweepActivate
 {
-    if(argc < 2)
+    SweepActivate(int _size): bits(_size, 1), ones(_size), cursor(0) {}
+
+    void set_1(int i)
     {
-        printf("Usage: ./main <data-file>\n");
-        printf("Example: ./main data/tsp_51_1\n");
-        exit(-1);
+        ones += bits[i] == 0;
+        bits[i] = 1;
     }
 
-    auto node_vec = load_node(argv[1]);
+    // once the active set empties, the sweep of the next step starts at node 0 again, as the old per-step scan did
+    void set_0(int i)
+    {
+        ones -= bits[i] == 1;
+        bits[i] = 0;
+        if(ones == 0) cursor = 0;
+    }
 
-    auto distance_matrix = get_distance_matrix(node_vec);
-    auto connection = init_connection(node_vec.size(), distance_matrix);
+    bool empty() const
+    {
+        return ones == 0;
+    }
+
+    int next()
+    {
+        while(!bits[cursor]) cursor = cursor + 1 == bits.size() ? 0 : cursor + 1;
+
+        auto i = cursor;
+        cursor = cursor + 1 == bits.size() ? 0 : cursor + 1;
+        return i;
+    }
+
+    vector<int> bits;
+    int ones;
+    int cursor;
+};
+
+// a FIFO work queue of active nodes with an in-queue bitmap, so the cost is proportional to the number of active nodes
+// a node leaves the queue when it is searched, and comes back at the end when one of its moves is taken
+struct QueueActivate
+{
+    QueueActivate(int _size): in_queue(_size, 1)
+    {
+        for(auto i = 0; i < _size; ++i)
+        {
+            nodes.push(i);
+        }
+    }
+
+    void set_1(int i)
+    {
+        if(in_queue[i]) return;
+
+        in_queue[i] = 1;
+        nodes.push(i);
+    }
+
+    void set_0(int) {}
+
+    bool empty() const
+    {
+        return nodes.empty();
+    }
+
+    int next()
+    {
+        auto i = nodes.front();
+        nodes.pop();
+        in_queue[i] = 0;
+        return i;
+    }
+
+    vector<char> in_queue;
+    queue<int> nodes;
+};
+
+auto print_tour(const Tour & tour, FILE * f = stdout)
+{
+    auto node = 0;
+    for(auto i = 0; i < tour.size(); ++i)
+    {
+        fprintf(f, "%d", node);
+        fprintf(f, i + 1 == tour.size() ? "\n" : " ");
+        node = tour.next(node);
+    }
+}
+
+// distance policies, the search functions are instantiated on one of them, so that every distance lookup
+// in the inner loops is a direct call that can be inlined, instead of going through type erasure
+
+// Euclidean distance computed on the fly from double coordinates
+struct EuclideanDistance
+{
+    // coordinates are kept as separate x and y arrays, so that the gain kernels can gather them into vector registers
+    EuclideanDistance(const vector<Node> & node_vec)
+    {
+        for(auto & node : node_vec)
+        {
+            x.push_back(node.x);
+            y.push_back(node.y);
+        }
+    }
+
+    double operator() (int i, int j) const
+    {
+        auto dx = x[i] - x[j];
+        auto dy = y[i] - y[j];
+        return sqrt(dx * dx + dy * dy);
+    }
+
+    // whether edge i -> j must stay in the tour, only a sub-path has fixed edges
+    bool fixed(int, int) const
+    {
+        return false;
+    }
+
+    vector<double> x;
+    vector<double> y;
+};
+
+// Euclidean distance computed on the fly from float coordinates, half the memory traffic of double coordinates
+struct FloatDistance
+{
+    FloatDistance(const vector<Node> & node_vec)
+    {
+        for(auto & node : node_vec)
+        {
+            x.push_back(static_cast<float>(node.x));
+            y.push_back(static_cast<float>(node.y));
+        }
+    }
+
+    double operator() (int i, int j) const
+    {
+        auto dx = x[i] - x[j];
+        auto dy = y[i] - y[j];
+        return sqrtf(dx * dx + dy * dy);
+    }
+
+    bool fixed(int, int) const
+    {
+        return false;
+    }
+
+    vector<float> x;
+    vector<float> y;
+};
+
+// full precomputed n * n matrix, only for small n
+struct MatrixDistance
+{
+    MatrixDistance(const vector<Node> & node_vec): node_count(node_vec.size()), matrix(node_count * node_count)
+    {
+        auto euclidean = EuclideanDistance(node_vec);
+        for(auto i = 0; i < node_count; ++i)
+        {
+            for(auto j = 0; j < node_count; ++j)
+            {
+                matrix[i * node_count + j] = euclidean(i, j);
+            }
+        }
+    }
+
+    double operator() (int i, int j) const
+    {
+        return matrix[i * node_count + j];
+    }
+
+    bool fixed(int, int) const
+    {
+        return false;
+    }
+
+    size_t node_count;
+    vector<double> matrix;
+};
+
+// distance policy of a sub-path whose nodes are renumbered 0..m along the path, the sub-path is searched as a cycle,
+// and the edge m -> 0 that closes it is fixed, so that the two endpoints stay where they are in the full tour
+template<typename Distance>
+struct SubPathDistance
+{
+    SubPathDistance(const Distance & _distance_matrix, const vector<int> & _global): 
+        distance_matrix(_distance_matrix), global(_global), last(static_cast<int>(_global.size()) - 1) {}
+
+    double operator() (int i, int j) const
+    {
+        return distance_matrix(global[i], global[j]);
+    }
+
+    bool fixed(int i, int j) const
+    {
+        return (i == 0 && j == last) || (i == last && j == 0);
+    }
+
+    const Distance & distance_matrix;
+    const vector<int> & global;
+    int last;
+};
+
+// distance between the nodes of the reduced instance of backbone mode, node i is node global[i] of the whole tour,
+// and mate[i] is the other end of the chain of fixed edges collapsed between them, -1 if node i is not collapsed
+template<typename Distance>
+struct ReducedDistance
+{
+    ReducedDistance(const Distance & _distance_matrix, const vector<int> & _global, const vector<int> & _mate): 
+        distance_matrix(_distance_matrix), global(_global), mate(_mate) {}
+
+    double operator() (int i, int j) const
+    {
+        return distance_matrix(global[i], global[j]);
+    }
+
+    bool fixed(int i, int j) const
+    {
+        return mate[i] == j;
+    }
+
+    const Distance & distance_matrix;
+    const vector<int> & global;
+    const vector<int> & mate;
+};
+
+// gains of a block of 2-opt moves that share t1 -> t2, move i replaces t1 -> t2 and t3[i] -> t4[i] with t1 -> t3[i] and
+// t2 -> t4[i], c12 is the augmented cost of t1 -> t2, and p34, p13, p24 are the penalties of the other three edges
+// every kernel evaluates the gain with the same operations in the same order as the scalar one, and the vector add, mul,
+// sub and sqrt instructions round exactly like the scalar ones, so all kernels give bit-identical gains
+using GainKernel = void (*)(const double * x, const double * y, int t1, int t2, const int * t3, const int * t4, 
+                            const double * p34, const double * p13, const double * p24, double c12, double lambda, int count, double * gain);
+
+// a target attribute that brings fma along (avx512f does) lets gcc fuse a mul and the add after it, which rounds once
+// instead of twice, so contraction is turned off for all the kernels
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+auto gain_scalar(const double * x, const double * y, int t1, int t2, const int * t3, const int * t4, 
+                    const double * p34, const double * p13, const double * p24, double c12, double lambda, int count, double * gain)
+{
+    auto distance = [&](int i, int j)
+    {
+        auto dx = x[i] - x[j];
+        auto dy = y[i] - y[j];
+        return sqrt(dx * dx + dy * dy);
+    };
+
+    for(auto i = 0; i < count; ++i)
+    {
+        gain[i] = c12 + (distance(t3[i], t4[i]) + lambda * p34[i]) - (distance(t1, t3[i]) + lambda * p13[i]) - 
+                    (distance(t2, t4[i]) + lambda * p24[i]);
+    }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// the vector kernels are compiled for their instruction set with target attributes, and only called when the cpu
+// supports it, so the binary runs everywhere without -mavx2
+
+__attribute__((target("avx2"))) inline __m256d distance_avx2(__m256d ax, __m256d ay, __m256d bx, __m256d by)
+{
+    auto dx = _mm256_sub_pd(ax, bx);
+    auto dy = _mm256_sub_pd(ay, by);
+    return _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+}
+
+// the masked gather with a zero source, the plain one trips -Wmaybe-uninitialized in some gcc headers
+__attribute__((target("avx2"))) inline __m256d gather_avx2(const double * base, __m128i index)
+{
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, index, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+__attribute__((target("avx2"))) void gain_avx2(const double * x, const double * y, int t1, int t2, const int * t3, const int * t4, 
+                    const double * p34, const double * p13, const double * p24, double c12, double lambda, int count, double * gain)
+{
+    auto x1 = _mm256_set1_pd(x[t1]), y1 = _mm256_set1_pd(y[t1]);
+    auto x2 = _mm256_set1_pd(x[t2]), y2 = _mm256_set1_pd(y[t2]);
+    auto c12_vec = _mm256_set1_pd(c12);
+    auto lambda_vec = _mm256_set1_pd(lambda);
+
+    auto i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        auto i3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t3 + i));
+        auto i4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t4 + i));
+        auto x3 = gather_avx2(x, i3), y3 = gather_avx2(y, i3);
+        auto x4 = gather_avx2(x, i4), y4 = gather_avx2(y, i4);
+
+        auto c34 = _mm256_add_pd(distance_avx2(x3, y3, x4, y4), _mm256_mul_pd(lambda_vec, _mm256_loadu_pd(p34 + i)));
+        auto c13 = _mm256_add_pd(distance_avx2(x1, y1, x3, y3), _mm256_mul_pd(lambda_vec, _mm256_loadu_pd(p13 + i)));
+        auto c24 = _mm256_add_pd(distance_avx2(x2, y2, x4, y4), _mm256_mul_pd(lambda_vec, _mm256_loadu_pd(p24 + i)));
+        _mm256_storeu_pd(gain + i, _mm256_sub_pd(_mm256_sub_pd(_mm256_add_pd(c12_vec, c34), c13), c24));
+    }
+
+    gain_scalar(x, y, t1, t2, t3 + i, t4 + i, p34 + i, p13 + i, p24 + i, c12, lambda, count - i, gain + i);
+}
+
+// masked sqrt with a zero source, for the same reason as the gathers
+__attribute__((target("avx512f,avx512vl"))) inline __m512d distance_avx512(__m512d ax, __m512d ay, __m512d bx, __m512d by)
+{
+    auto dx = _mm512_sub_pd(ax, bx);
+    auto dy = _mm512_sub_pd(ay, by);
+    return _mm512_mask_sqrt_pd(_mm512_setzero_pd(), 0xff, _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)));
+}
+
+__attribute__((target("avx512f,avx512vl"))) inline __m512d gather_avx512(const double * base, __m256i index, __mmask8 mask)
+{
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, index, base, 8);
+}
+
+// the last partial block of 8 moves is handled with masked loads and stores instead of a scalar tail,
+// since blocks are short (2k moves), and a scalar tail would take a large share of the time
+__attribute__((target("avx512f,avx512vl"))) void gain_avx512(const double * x, const double * y, int t1, int t2, const int * t3, const int * t4, 
+                    const double * p34, const double * p13, const double * p24, double c12, double lambda, int count, double * gain)
+{
+    auto x1 = _mm512_set1_pd(x[t1]), y1 = _mm512_set1_pd(y[t1]);
+    auto x2 = _mm512_set1_pd(x[t2]), y2 = _mm512_set1_pd(y[t2]);
+    auto c12_vec = _mm512_set1_pd(c12);
+    auto lambda_vec = _mm512_set1_pd(lambda);
+
+    for(auto i = 0; i < count; i += 8)
+    {
+        auto mask = static_cast<__mmask8>(count - i >= 8 ? 0xff : (1 << (count - i)) - 1);
+
+        auto i3 = _mm256_maskz_loadu_epi32(mask, t3 + i);
+        auto i4 = _mm256_maskz_loadu_epi32(mask, t4 + i);
+        auto x3 = gather_avx512(x, i3, mask), y3 = gather_avx512(y, i3, mask);
+        auto x4 = gather_avx512(x, i4, mask), y4 = gather_avx512(y, i4, mask);
+
+        auto c34 = _mm512_add_pd(distance_avx512(x3, y3, x4, y4), _mm512_mul_pd(lambda_vec, _mm512_maskz_loadu_pd(mask, p34 + i)));
+        auto c13 = _mm512_add_pd(distance_avx512(x1, y1, x3, y3), _mm512_mul_pd(lambda_vec, _mm512_maskz_loadu_pd(mask, p13 + i)));
+        auto c24 = _mm512_add_pd(distance_avx512(x2, y2, x4, y4), _mm512_mul_pd(lambda_vec, _mm512_maskz_loadu_pd(mask, p24 + i)));
+        _mm512_mask_storeu_pd(gain + i, mask, _mm512_sub_pd(_mm512_sub_pd(_mm512_add_pd(c12_vec, c34), c13), c24));
+    }
+}
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+// the kernel named by --simd, auto picks the widest one the cpu supports, nullptr if the cpu does not support it
+auto get_gain_kernel(const string & simd) -> GainKernel
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+    __builtin_cpu_init();
+    auto avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+    auto avx2 = __builtin_cpu_supports("avx2");
+    if(simd == "avx512") return avx512 ? gain_avx512 : nullptr;
+    if(simd == "avx2") return avx2 ? gain_avx2 : nullptr;
+    if(simd == "auto") return avx512 ? gain_avx512 : avx2 ? gain_avx2 : gain_scalar;
+#endif
+    return simd == "scalar" || simd == "auto" ? gain_scalar : nullptr;
+}
+
+// kernel used for the Euclidean distance policy, set once at startup
+GainKernel gain_kernel = gain_scalar;
+
+// gains of a block of 2-opt moves with any distance policy, one move at a time
+template<typename Distance>
+void block_gain(const Distance & distance_matrix, int t1, int t2, const int * t3, const int * t4, 
+                const double * p34, const double * p13, const double * p24, double c12, double lambda, int count, double * gain)
+{
+    for(auto i = 0; i < count; ++i)
+    {
+        gain[i] = c12 + (distance_matrix(t3[i], t4[i]) + lambda * p34[i]) - (distance_matrix(t1, t3[i]) + lambda * p13[i]) - 
+                    (distance_matrix(t2, t4[i]) + lambda * p24[i]);
+    }
+}
+
+// the Euclidean distance policy computes its distances from the coordinates, so its gains go through the vector kernel
+void block_gain(const EuclideanDistance & distance_matrix, int t1, int t2, const int * t3, const int * t4, 
+                const double * p34, const double * p13, const double * p24, double c12, double lambda, int count, double * gain)
+{
+    gain_kernel(distance_matrix.x.data(), distance_matrix.y.data(), t1, t2, t3, t4, p34, p13, p24, c12, lambda, count, gain);
+}
+
+// build the candidate lists once with a k-d tree, in O(n log n) instead of O(n^2)
+auto get_neighbor_list(const vector<Node> & node_vec, int k)
+{
+    auto node_count = static_cast<int>(node_vec.size());
+
+    NeighborList neighbor_list;
+    neighbor_list.k = min(k, node_count - 1);
+    if(neighbor_list.k <= 0)
+    {
+        neighbor_list.k = 0;
+        return neighbor_list;
+    }
+
+    auto kd_tree = KdTree(node_vec);
+    neighbor_list.neighbors.reserve(static_cast<size_t>(node_count) * neighbor_list.k);
+    for(auto i = 0; i < node_count; ++i)
+    {
+        auto nearest = kd_tree.nearest(i, neighbor_list.k);
+        neighbor_list.neighbors.insert(neighbor_list.neighbors.end(), nearest.begin(), nearest.end());
+    }
+    return neighbor_list;
+}
+
+template<typename Distance>
+auto total_distance(const Tour & tour, const Distance & distance_matrix)
+{
+    auto dis = 0.0;
+    for(auto i = 0; i < tour.size(); ++i)
+    {
+        dis += distance_matrix(i, tour.next(i));
+    }
+
+    return dis;
+}
+
+// nearest neighbor tour by scanning every unvisited node, O(n^2)
+template<typename Distance>
+auto init_tour_scan(int node_count, const Distance & distance_matrix)
+{
+    vector<int> tour;
+    for(auto i = 0; i < node_count; ++i)
+    {
+        tour.push_back(i);
+    }
+
+    for(auto i = 0; i + 1 < tour.size(); ++i)
+    {
+        auto min_distance = (numeric_limits<double>::max)();
+        auto min_distance_node = -1;
+        
+        for(auto j = i + 1; j < tour.size(); ++j)
+        {
+            auto distance = distance_matrix(tour[i], tour[j]);
+            if(min_distance > distance)
+            {
+                min_distance = distance;
+                min_distance_node = j;
+            }
+        }
+        swap(tour[i + 1], tour[min_distance_node]);
+    }
+
+    return tour;
+}
+
+// nearest neighbor tour, the nearest unvisited node is found with a k-d tree whose visited nodes are removed, O(n log n)
+auto init_tour_nn(const vector<Node> & node_vec)
+{
+    auto kd_tree = KdTree(node_vec);
+
+    vector<int> tour;
+    tour.reserve(node_vec.size());
+    for(auto node = 0; node != -1; node = kd_tree.nearest_alive(node_vec[node]))
+    {
+        tour.push_back(node);
+        kd_tree.remove(node);
+    }
+    return tour;
+}
+
+struct DisjointSet
+{
+    DisjointSet(int n): parent(n)
+    {
+        iota(parent.begin(), parent.end(), 0);
+    }
+
+    int find(int i)
+    {
+        while(parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    bool unite(int i, int j)
+    {
+        i = find(i);
+        j = find(j);
+        if(i == j) return false;
+        parent[i] = j;
+        return true;
+    }
+
+    vector<int> parent;
+};
+
+// greedy edge matching, the shortest candidate edges are added as long as no node gets degree 3 and no cycle is closed,
+// then the resulting paths are joined end to end by nearest endpoint, O(n log n)
+auto init_tour_greedy(const vector<Node> & node_vec)
+{
+    auto node_count = static_cast<int>(node_vec.size());
+    if(node_count < 3) return init_tour_nn(node_vec);
+
+    // only edges to the nearest neighbors are considered, the rest of the tour is closed by the endpoint join
+    auto candidate_count = min(10, node_count - 1);
+    auto kd_tree = KdTree(node_vec);
+    auto length = [&](int i, int j)
+    {
+        auto dx = node_vec[i].x - node_vec[j].x, dy = node_vec[i].y - node_vec[j].y;
+        return dx * dx + dy * dy;
+    };
+
+    vector<tuple<double, int, int>> edges;
+    edges.reserve(static_cast<size_t>(node_count) * candidate_count);
+    for(auto i = 0; i < node_count; ++i)
+    {
+        for(auto j : kd_tree.nearest(i, candidate_count))
+        {
+            edges.emplace_back(length(i, j), min(i, j), max(i, j));
+        }
+    }
+    // an edge found from both of its ends is kept once
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+    vector<array<int, 2>> adjacent(node_count, {-1, -1});
+    vector<int> degree(node_count, 0);
+    DisjointSet fragment(node_count);
+    for(auto & [d, i, j] : edges)
+    {
+        if(degree[i] == 2 || degree[j] == 2 || !fragment.unite(i, j)) continue;
+        adjacent[i][degree[i]++] = j;
+        adjacent[j][degree[j]++] = i;
+    }
+
+    // only path endpoints (degree < 2, isolated nodes included) can be joined
+    for(auto i = 0; i < node_count; ++i)
+    {
+        if(degree[i] == 2) kd_tree.remove(i);
+    }
+
+    vector<int> tour;
+    tour.reserve(node_count);
+    for(auto start = 0; start != -1; )
+    {
+        if(degree[start] == 2) start = kd_tree.nearest_alive(node_vec[start]);
+
+        // walk the path from start to its other end
+        auto prev = -1, node = start;
+        while(true)
+        {
+            tour.push_back(node);
+            auto next = adjacent[node][0] != prev ? adjacent[node][0] : adjacent[node][1];
+            if(next == -1) break;
+            prev = node;
+            node = next;
+        }
+        kd_tree.remove(start);
+        kd_tree.remove(node);
+
+        start = kd_tree.nearest_alive(node_vec[node]);
+    }
+    return tour;
+}
+
+// index of cell (x, y) along a Hilbert curve filling a 2^order x 2^order grid
+auto hilbert_index(uint32_t x, uint32_t y, int order)
+{
+    uint64_t d = 0;
+    for(uint32_t s = 1u << (order - 1); s > 0; s >>= 1)
+    {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant so that the curve inside it starts and ends at the right corners
+        if(ry == 0)
+        {
+            if(rx == 1)
+            {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return d;
+}
+
+// nodes sorted by their position along a Hilbert space-filling curve, O(n log n)
+auto init_tour_sfc(const vector<Node> & node_vec)
+{
+    auto order = 16;
+    auto min_x = (numeric_limits<double>::max)(), max_x = -min_x;
+    auto min_y = min_x, max_y = max_x;
+    for(auto node : node_vec)
+    {
+        min_x = min(min_x, node.x);
+        max_x = max(max_x, node.x);
+        min_y = min(min_y, node.y);
+        max_y = max(max_y, node.y);
+    }
+
+    // the same scale on both axes, so that the curve does not stretch the instance
+    auto scale = ((1u << order) - 1) / max(1e-9, max(max_x - min_x, max_y - min_y));
+    vector<pair<uint64_t, int>> key(node_vec.size());
+    for(auto i = 0; i < node_vec.size(); ++i)
+    {
+        auto x = static_cast<uint32_t>((node_vec[i].x - min_x) * scale);
+        auto y = static_cast<uint32_t>((node_vec[i].y - min_y) * scale);
+        key[i] = make_pair(hilbert_index(x, y, order), i);
+    }
+    sort(key.begin(), key.end());
+
+    vector<int> tour(node_vec.size());
+    for(auto i = 0; i < key.size(); ++i) tour[i] = key[i].second;
+    return tour;
+}
+
+// build the starting tour with the given construction heuristic, and report its construction time and length
+template<typename Distance>
+auto init_tour(const string & method, const vector<Node> & node_vec, const Distance & distance_matrix)
+{
+    auto start_time = chrono::steady_clock::now();
+
+    vector<int> order;
+    if(method == "scan") order = init_tour_scan(node_vec.size(), distance_matrix);
+    else if(method == "greedy") order = init_tour_greedy(node_vec);
+    else if(method == "sfc") order = init_tour_sfc(node_vec);
+    else order = init_tour_nn(node_vec);
+    auto tour = Tour(order);
+
+    auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    printf("[init %s] [time %.3lfs] [distance %lf]\n", method.c_str(), seconds, total_distance(tour, distance_matrix));
+    return tour;
+}
+
+
+// random sample from a vector, every search owns its generator, so that parallel searches do not share one
+template<typename T>
+T random_sample(const vector<T> & vec, default_random_engine & generator)
+{
+	assert(!vec.empty());
+
+	uniform_int_distribution<size_t> distribution(0, vec.size() - 1);
+	auto random_index = distribution(generator);
+
+	return vec[random_index];
+}
+
+
+// swap two edges, with four vertexes: t1, t2, t3, t4
+// before swapping, the two edges are: t1 -> t2, t3 -> t4
+// after swapping, the two edges are: t1 -> t3, t2 -> t4
+
+
+// when candidate lists are used, only two kinds of move are looked at:
+// t3 is a candidate neighbor of t1, so that the new edge t1 -> t3 is short, then t4 is the node after t3
+// t4 is a candidate neighbor of t2, so that the new edge t2 -> t4 is short, then t3 is the node before t4
+// a move that makes neither new edge short is hardly ever an improvement, so one sweep costs O(n * k) instead of O(n^2)
+template<typename Distance>
+auto select_t3_t4(int t1, int t2, const Tour & tour, const Distance & distance_matrix, 
+                            const Penalty & penalty, double lambda, const NeighborList & neighbor_list, default_random_engine & generator)
+{
+    auto max_gain = -(numeric_limits<double>::max)();
+    auto t4_candidate = vector<int>();
+    auto t2_out = tour.next(t2);
+
+    if(distance_matrix.fixed(t1, t2)) return make_tuple(-1, -1);
+
+    auto d12 = distance_matrix(t1, t2);
+    auto p12 = penalty(t1, t2);
+
+    // valid moves are collected into a block, and the gains of a full block are computed at once by block_gain,
+    // the block is then scanned in the order the moves were found, so that ties come out the same as one by one
+    constexpr int block_size = 64;
+    alignas(64) int t3_block[block_size], t4_block[block_size];
+    alignas(64) double p34_block[block_size], p13_block[block_size], p24_block[block_size], gain_block[block_size];
+    auto block_count = 0;
+
+    auto flush = [&]()
+    {
+        block_gain(distance_matrix, t1, t2, t3_block, t4_block, p34_block, p13_block, p24_block, 
+                    d12 + lambda * p12, lambda, block_count, gain_block);
+
+        for(auto i = 0; i < block_count; ++i)
+        {
+            auto gain = gain_block[i];
+            if(max_gain < gain)
+            {
+                max_gain = gain;
+                t4_candidate.clear();
+                t4_candidate.push_back(t4_block[i]);
+            }
+            else if(max_gain == gain)
+            {
+                t4_candidate.push_back(t4_block[i]);
+            }
+        }
+        block_count = 0;
+    };
+
+    auto try_t4 = [&](int t4)
+    {
+        auto t3 = tour.prev(t4);
+
+        if(t4 == t1 || t4 == t2 || t4 == t2_out || distance_matrix.fixed(t3, t4)) return;
+
+        t3_block[block_count] = t3;
+        t4_block[block_count] = t4;
+        p34_block[block_count] = penalty(t3, t4);
+        p13_block[block_count] = penalty(t1, t3);
+        p24_block[block_count] = penalty(t2, t4);
+        if(++block_count == block_size) flush();
+    };
+
+    if(neighbor_list.k == 0)
+    {
+        for(auto i = 0; i < tour.size(); ++i)
+        {
+            try_t4(i);
+        }
+    }
+    else
+    {
+        for(auto it = neighbor_list.begin(t1); it != neighbor_list.end(t1); ++it)
+        {
+            try_t4(tour.next(*it));
+        }
+        // a t4 whose t3 is also a candidate of t1 has been tried already, trying it again would double its weight in
+        // the tie-break
+        for(auto it = neighbor_list.begin(t2); it != neighbor_list.end(t2); ++it)
+        {
+            if(find(neighbor_list.begin(t1), neighbor_list.end(t1), tour.prev(*it)) != neighbor_list.end(t1)) continue;
+            try_t4(*it);
+        }
+    }
+    flush();
+
+    if(max_gain > 1e-6)
+    {
+        auto t4 = random_sample(t4_candidate, generator);
+        auto t3 = tour.prev(t4);
+
+        return make_tuple(t3, t4);
+    }
+
+    return make_tuple(-1, -1);
+}
+
+
+
+// utility of penalizing edge a -> b, fixed edges are never penalized
+template<typename Distance>
+auto edge_utility(int a, int b, const Distance & distance_matrix, const Penalty & penalty)
+{
+    if(distance_matrix.fixed(a, b)) return -(numeric_limits<double>::max)();
+
+    auto d = distance_matrix(a, b);
+    auto p = (1 + penalty(a, b));
+    return d / (1 + p);
+}
+
+template<typename Distance>
+auto get_utility_heap(const Tour & tour, const Distance & distance_matrix, const Penalty & penalty)
+{
+    auto utility = UtilityHeap(tour.size());
+    for(auto i = 0; i < tour.size(); ++i)
+    {
+        utility.add(i, tour.next(i), edge_utility(i, tour.next(i), distance_matrix, penalty));
+    }
+    return utility;
+}
+
+template<typename Distance>
+auto swap_edge(int t1, int t2, int t3, int t4, Tour & tour, const Distance & distance_matrix, 
+                const Penalty & penalty, UtilityHeap & utility, double & distance, double & augmented_distance, double lambda)
+{
+    // reverse the path t2 -> t3, so that t1 -> t3 and t2 -> t4
+    tour.reverse(t2, t3);
+
+    utility.remove(t1, t2);
+    utility.remove(t3, t4);
+    utility.add(t1, t3, edge_utility(t1, t3, distance_matrix, penalty));
+    utility.add(t2, t4, edge_utility(t2, t4, distance_matrix, penalty));
+
+    auto d12 = distance_matrix(t1, t2);
+    auto d34 = distance_matrix(t3, t4);
+    auto d13 = distance_matrix(t1, t3);
+    auto d24 = distance_matrix(t2, t4);
+
+    auto p12 = penalty(t1, t2);
+    auto p34 = penalty(t3, t4);
+    auto p13 = penalty(t1, t3);
+    auto p24 = penalty(t2, t4);
+
+    auto gain = (d12 + lambda * p12) + (d34 + lambda * p34) - (d13 + lambda * p13) - (d24 + lambda * p24);
+
+    distance -= d12 + d34 - d13 - d24;
+    augmented_distance -= gain;
+}
+
+// Lin-Kernighan style variable-depth move, built from sequential 2-opt flips that keep t1 fixed:
+// the tour edge t1 -> t2 is removed, the new edge t2 -> t3 is added, where t3 is a candidate neighbor of t2,
+// and the edge t4 -> t3 is removed, with t4 before t3, so that closing the tour with t1 -> t4 is a 2-opt flip,
+// then t4 takes the place of t2 and the chain goes on, as long as the running gain g stays positive
+// the chain is cut back to the depth where closing it gave the best gain, and dropped if that gain is not positive,
+// gains are measured on the augmented cost, and an edge added by the chain is never removed again
+// only the first step tries every t3, in the order of g - c(t2, t3) + c(t4, t3), deeper steps take the best one
+// while a chain is tried, its flips are only recorded as reversed ranges of tour positions, and a node is looked up
+// through them in O(depth), so a chain that is dropped costs no node moves, the kept flips are applied to the tour
+template<typename Distance>
+auto lk_move(int t1, int t2, Tour & tour, const Distance & distance_matrix, const Penalty & penalty, UtilityHeap & utility, 
+                double & distance, double & augmented_distance, double lambda, const NeighborList & neighbor_list, 
+                int max_depth, vector<int> & touched)
+{
+    if(distance_matrix.fixed(t1, t2)) return false;
+
+    auto cost = [&](int a, int b)
+    {
+        return distance_matrix(a, b) + lambda * penalty(a, b);
+    };
+
+    vector<tuple<int, int>> added, removed;
+    auto contains = [](const vector<tuple<int, int>> & edges, int a, int b)
+    {
+        for(auto [x, y] : edges)
+        {
+            if((x == a && y == b) || (x == b && y == a)) return true;
+        }
+        return false;
+    };
+
+    // the chain walks the tour in direction dir, t2 follows t1
+    auto n = tour.size();
+    auto dir = tour.next(t1) == t2 ? 1 : n - 1;
+
+    // reversed ranges (first position, length) of the flips tried so far, a reversal maps a position onto itself
+    // in both directions, so positions go through the ranges in order one way, and in reverse order the other way
+    vector<tuple<int, int>> ranges;
+    auto reflect = [&](int p, int first, int length)
+    {
+        auto offset = p - first < 0 ? p - first + n : p - first;
+        if(offset >= length) return p;
+        auto q = first + length - 1 - offset;
+        return q >= n ? q - n : q;
+    };
+    auto position = [&](int node)
+    {
+        auto p = tour.pos[node];
+        for(auto [first, length] : ranges) p = reflect(p, first, length);
+        return p;
+    };
+    auto node_at = [&](int p)
+    {
+        for(auto it = ranges.rbegin(); it != ranges.rend(); ++it) p = reflect(p, get<0>(*it), get<1>(*it));
+        return tour.order[p];
+    };
+    auto pred = [&](int node)
+    {
+        return node_at((position(node) + n - dir) % n);
+    };
+    // reverse the path a -> b that follows direction dir
+    auto reverse_path = [&](int a, int b)
+    {
+        auto pa = position(a), pb = position(b);
+        if(dir == 1) ranges.push_back(make_tuple(pa, (pb - pa + n) % n + 1));
+        else ranges.push_back(make_tuple(pb, (pa - pb + n) % n + 1));
+    };
+
+    // the possible next steps from t2 with running gain g, best lookahead first
+    auto next_steps = [&](int t2, double g)
+    {
+        vector<tuple<double, int, int>> steps;
+        auto try_t3 = [&](int t3)
+        {
+            if(t3 == t1 || t3 == t2) return;
+
+            auto t4 = pred(t3);
+            if(t4 == t2) return;
+
+            auto g1 = g - cost(t2, t3);
+            if(g1 <= 0 || distance_matrix.fixed(t4, t3) || contains(added, t4, t3) || contains(removed, t2, t3)) return;
+
+            steps.push_back(make_tuple(g1 + cost(t4, t3), t3, t4));
+        };
+
+        if(neighbor_list.k == 0)
+        {
+            for(auto t3 = 0; t3 < n; ++t3)
+            {
+                try_t3(t3);
+            }
+        }
+        else
+        {
+            for(auto it = neighbor_list.begin(t2); it != neighbor_list.end(t2); ++it)
+            {
+                try_t3(*it);
+            }
+        }
+        sort(steps.begin(), steps.end(), greater<tuple<double, int, int>>());
+        return steps;
+    };
+
+    for(auto [lookahead, t3, t4] : next_steps(t2, cost(t1, t2)))
+    {
+        auto g = cost(t1, t2);
+        auto last = t2;
+        auto best_gain = 1e-6;
+        auto best_depth = 0;
+
+        vector<tuple<int, int, int, int>> flips;
+        ranges.clear();
+        added.clear();
+        removed.assign(1, make_tuple(t1, t2));
+
+        while(true)
+        {
+            g = g - cost(last, t3) + cost(t4, t3);
+            reverse_path(last, t4);
+            flips.push_back(make_tuple(t1, last, t4, t3));
+            added.push_back(make_tuple(last, t3));
+            removed.push_back(make_tuple(t4, t3));
+
+            auto closing_gain = g - cost(t4, t1);
+            if(closing_gain > best_gain)
+            {
+                best_gain = closing_gain;
+                best_depth = flips.size();
+            }
+
+            last = t4;
+            if(flips.size() == max_depth) break;
+
+            auto steps = next_steps(last, g);
+            if(steps.empty()) break;
+            tie(lookahead, t3, t4) = steps[0];
+        }
+
+        if(best_depth == 0) continue;
+
+        // apply the kept flips: a -> b and c -> d are replaced with a -> c and b -> d, whichever way the tour is oriented
+        touched.push_back(t1);
+        for(auto i = 0; i < best_depth; ++i)
+        {
+            auto [a, b, c, d] = flips[i];
+            if(tour.next(a) == b) swap_edge(a, b, c, d, tour, distance_matrix, penalty, utility, distance, augmented_distance, lambda);
+            else swap_edge(d, c, b, a, tour, distance_matrix, penalty, utility, distance, augmented_distance, lambda);
+
+            touched.push_back(b);
+            touched.push_back(c);
+            touched.push_back(d);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// Or-opt move: the segment s1 -> s2 of 1 to 3 nodes is cut out between p and n, and put back between c and d,
+// as c -> s1 -> s2 -> d, or reversed as c -> s2 -> s1 -> d
+// before moving, the edges are: p -> s1, s2 -> n, c -> d
+// after moving, the edges are: p -> n, c -> s1, s2 -> d (or c -> s2, s1 -> d)
+// when candidate lists are used, c or d has to be a candidate neighbor of the segment end it gets linked to,
+// so each segment costs O(k), every gain is evaluated in O(1) from the six edges involved
+template<typename Distance>
+auto select_or_opt(int s1, const Tour & tour, const Distance & distance_matrix, 
+                    const Penalty & penalty, double lambda, const NeighborList & neighbor_list, default_random_engine & generator)
+{
+    auto max_gain = -(numeric_limits<double>::max)();
+    auto move_candidate = vector<tuple<int, int, int, bool>>();
+
+    auto cost = [&](int a, int b)
+    {
+        return distance_matrix(a, b) + lambda * penalty(a, b);
+    };
+
+    // a segment and its two neighbors have to leave at least one other edge to insert into
+    auto max_length = min(3, tour.size() - 5);
+
+    auto p = tour.prev(s1);
+    if(distance_matrix.fixed(p, s1)) max_length = 0;
+
+    auto s2 = s1;
+    for(auto length = 1; length <= max_length; ++length, s2 = tour.next(s2))
+    {
+        auto n = tour.next(s2);
+        if(distance_matrix.fixed(s2, n)) continue;
+
+        auto remove_gain = cost(p, s1) + cost(s2, n) - cost(p, n);
+
+        auto try_c_d = [&](int c, int d, bool reversed)
+        {
+            // c -> d must not touch the segment, c == p or d == s1 is the edge being cut out
+            if(c == p || tour.between(s1, c, s2) || tour.between(s1, d, s2) || distance_matrix.fixed(c, d)) return;
+
+            auto gain = remove_gain + cost(c, d) - (reversed ? cost(c, s2) + cost(s1, d) : cost(c, s1) + cost(s2, d));
+
+            if(max_gain < gain)
+            {
+                max_gain = gain;
+                move_candidate.clear();
+                move_candidate.push_back(make_tuple(s2, c, d, reversed));
+            }
+            else if(max_gain == gain)
+            {
+                move_candidate.push_back(make_tuple(s2, c, d, reversed));
+            }
+        };
+
+        // x is linked to s1 or to s2, either as c or as d
+        auto try_x = [&](int x, bool near_s1)
+        {
+            if(near_s1)
+            {
+                try_c_d(x, tour.next(x), false);
+                try_c_d(tour.prev(x), x, true);
+            }
+            else
+            {
+                try_c_d(tour.prev(x), x, false);
+                try_c_d(x, tour.next(x), true);
+            }
+        };
+
+        if(neighbor_list.k == 0)
+        {
+            for(auto x = 0; x < tour.size(); ++x)
+            {
+                try_x(x, true);
+                try_x(x, false);
+            }
+        }
+        else
+        {
+            for(auto it = neighbor_list.begin(s1); it != neighbor_list.end(s1); ++it)
+            {
+                try_x(*it, true);
+            }
+            for(auto it = neighbor_list.begin(s2); it != neighbor_list.end(s2); ++it)
+            {
+                try_x(*it, false);
+            }
+        }
+    }
+
+    if(max_gain > 1e-6)
+    {
+        auto [s2, c, d, reversed] = random_sample(move_candidate, generator);
+        return make_tuple(s2, c, d, reversed);
+    }
+
+    return make_tuple(-1, -1, -1, false);
+}
+
+// 2-opt move given by its edges: a -> b and c -> d are replaced with a -> c and b -> d,
+// whichever way the tour is oriented
+auto exchange_edge(int a, int b, int c, int d, Tour & tour)
+{
+    if(tour.next(a) == b) tour.reverse(b, c);
+    else tour.reverse(a, d);
+}
+
+template<typename Distance>
+auto move_segment(int s1, int s2, int c, int d, bool reversed, Tour & tour, const Distance & distance_matrix, 
+                    const Penalty & penalty, UtilityHeap & utility, double & distance, double & augmented_distance, double lambda)
+{
+    auto p = tour.prev(s1);
+    auto n = tour.next(s2);
+
+    auto delta = [&](double w)
+    {
+        auto old_length = distance_matrix(p, s1) + distance_matrix(s2, n) + distance_matrix(c, d);
+        auto new_length = distance_matrix(p, n) + 
+                            (reversed ? distance_matrix(c, s2) + distance_matrix(s1, d) : distance_matrix(c, s1) + distance_matrix(s2, d));
+        auto old_penalty = penalty(p, s1) + penalty(s2, n) + penalty(c, d);
+        auto new_penalty = penalty(p, n) + (reversed ? penalty(c, s2) + penalty(s1, d) : penalty(c, s1) + penalty(s2, d));
+        return old_length - new_length + w * (old_penalty - new_penalty);
+    };
+
+    distance -= delta(0.0);
+    augmented_distance -= delta(lambda);
+
+    // all three edges are removed before any is added, since an added edge may be a removed one turned around
+    utility.remove(p, s1);
+    utility.remove(s2, n);
+    utility.remove(c, d);
+    utility.add(p, n, edge_utility(p, n, distance_matrix, penalty));
+    utility.add(c, reversed ? s2 : s1, edge_utility(c, reversed ? s2 : s1, distance_matrix, penalty));
+    utility.add(reversed ? s1 : s2, d, edge_utility(reversed ? s1 : s2, d, distance_matrix, penalty));
+
+    // three 2-opt moves: p -> c, s1 -> d, then p -> n, c -> s2, then the segment is turned around if needed
+    exchange_edge(p, s1, c, d, tour);
+    exchange_edge(p, c, n, s2, tour);
+    if(!reversed) exchange_edge(c, s2, s1, d, tour);
+}
+
+// penalize the edges with max utility, all of them when several are tied, found in the utility heap in O(log n)
+// per edge instead of a scan over the tour, they are penalized in the order a scan over the nodes would find them
+template<typename Distance, typename Activate>
+auto add_penalty(const Tour & tour, const Distance & distance_matrix, Penalty & penalty, UtilityHeap & utility, 
+                    Activate & activate, double & augmented_distance, double lambda)
+{
+    vector<tuple<int, int>> max_util_edge;
+    utility.max_edges(max_util_edge);
+
+    vector<int> max_util_node;
+    for(auto [a, b] : max_util_edge)
+    {
+        max_util_node.push_back(tour.next(a) == b ? a : b);
+    }
+    sort(max_util_node.begin(), max_util_node.end());
+
+    for(auto i : max_util_node)
+    {
+        auto i_out = tour.next(i);
+        penalty.add(i, i_out);
+        utility.update(i, i_out, edge_utility(i, i_out, distance_matrix, penalty));
+
+        activate.set_1(i);
+        activate.set_1(i_out);
+
+        augmented_distance += lambda;
+    }
+}
+
+
+template<typename Distance>
+auto total_augmented_distance(const Tour & tour, const Distance & distance_matrix, const Penalty & penalty, double lambda)
+{
+    auto augmented_dis = 0.0;
+    for(auto i = 0; i < tour.size(); ++i)
+    {
+        auto i_out = tour.next(i);
+        auto d = distance_matrix(i, i_out);
+        auto p = penalty(i, i_out);
+        augmented_dis += d + p * lambda;
+    }
+
+    return augmented_dis;
+}
+
+
+auto save_result(const char * filename, double distance, const Tour & tour)
+{
+    auto f = fopen(filename, "w");
+
+    fprintf(f, "%lf 0\n", distance);
+    print_tour(tour, f);
+
+    fclose(f);
+}
+
+auto load_node(const char * filename)
+{
+    auto f = fopen(filename, "r");
+
+    int node_count;
+    fscanf(f, "%d", &node_count);
+
+    vector<Node> node_vec;
+    for(auto i = 0; i < node_count; ++i)
+    {
+        Node p;
+        fscanf(f, "%lf %lf", &p.x, &p.y);
+        node_vec.push_back(p);
+    }
+    fclose(f);
+
+    return node_vec;
+}
+
+// tour of a result file written by save_result, it has to visit each of the node_count nodes once
+auto load_tour(const char * filename, int node_count)
+{
+    auto f = fopen(filename, "r");
+    if(!f)
+    {
+        printf("Cannot open tour file: %s\n", filename);
+        exit(-1);
+    }
+
+    double distance;
+    int optimal;
+    fscanf(f, "%lf %d", &distance, &optimal);
+
+    vector<int> order(node_count);
+    vector<char> visited(node_count, 0);
+    for(auto i = 0; i < node_count; ++i)
+    {
+        if(fscanf(f, "%d", &order[i]) != 1 || order[i] < 0 || order[i] >= node_count || visited[order[i]])
+        {
+            printf("Not a tour of %d nodes: %s\n", node_count, filename);
+            exit(-1);
+        }
+        visited[order[i]] = 1;
+    }
+    fclose(f);
+
+    return order;
+}
+
+template<typename Distance>
+auto init_lambda(const Tour & tour, const Distance & distance_matrix, double alpha)
+{
+    return alpha * total_distance(tour, distance_matrix) / tour.size();
+}
+
+// best tour found by any island, shared without locks like a seqlock: a writer claims the snapshot by making the version
+// odd, and gives up if another writer holds it, a reader copies the tour and gives up if the version moved meanwhile,
+// so that no island ever waits for another one
+struct SharedTour
+{
+    // the time limit of a search is counted from _start_time, which the sub-searches of a decomposition share
+    SharedTour(const Tour & tour, double _distance, bool _report = true, 
+                chrono::steady_clock::time_point _start_time = chrono::steady_clock::now()): 
+        version(0), distance(_distance), lower_bound(0), order(tour.size()), start_time(_start_time), report(_report)
+    {
+        for(auto i = 0; i < tour.size(); ++i)
+        {
+            order[i].store(tour.order[i], memory_order_relaxed);
+        }
+    }
+
+    double seconds() const
+    {
+        return chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    }
+
+    // optimality gap of the shared tour in percent, -1 while there is no lower bound
+    double gap() const
+    {
+        auto bound = lower_bound.load();
+        return bound > 0 ? 100 * (distance.load() / bound - 1) : -1;
+    }
+
+    // publish the tour if it is better than the shared one, the result file is written while the snapshot is claimed
+    bool publish(const Tour & tour, double tour_distance, int island)
+    {
+        auto v = version.load();
+        if(v % 2 == 1 || tour_distance >= distance.load()) return false;
+        if(!version.compare_exchange_strong(v, v + 1)) return false;
+        atomic_thread_fence(memory_order_release);
+
+        auto published = tour_distance < distance.load(memory_order_relaxed);
+        if(published)
+        {
+            for(auto i = 0; i < tour.size(); ++i)
+            {
+                order[i].store(tour.order[i], memory_order_relaxed);
+            }
+            distance.store(tour_distance, memory_order_relaxed);
+
+            if(report)
+            {
+                printf("[time %.3lfs] [island %-3d] [best distance %lf]", seconds(), island, tour_distance);
+                if(gap() >= 0) printf(" [gap %.3lf%%]", gap());
+                printf("\n");
+                save_result("cpp_output.txt", tour_distance, tour);
+            }
+        }
+
+        version.store(v + 2, memory_order_release);
+        return published;
+    }
+
+    // copy the shared tour, false if a writer got in the way
+    bool read(vector<int> & tour_order, double & tour_distance) const
+    {
+        auto v = version.load(memory_order_acquire);
+        if(v % 2 == 1) return false;
+
+        tour_distance = distance.load(memory_order_relaxed);
+        tour_order.resize(order.size());
+        for(auto i = 0; i < order.size(); ++i)
+        {
+            tour_order[i] = order[i].load(memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        return version.load(memory_order_relaxed) == v;
+    }
+
+    atomic<long long> version;
+    atomic<double> distance;
+
+    // best Held-Karp bound found so far, 0 until the bound thread reports one
+    atomic<double> lower_bound;
+    vector<atomic<int>> order;
+    chrono::steady_clock::time_point start_time;
+
+    // whether improvements are logged and written to the result file, false for the searches of sub-paths
+    bool report;
+};
+
+// Held-Karp lower bound: the min 1-tree (a spanning tree of the nodes other than node 0, plus the two cheapest edges
+// of node 0) with node weights pi added to the edges, minus twice the sum of pi, is a lower bound of the optimal tour,
+// pi is moved along the subgradient deg - 2 to raise the bound, with the step of Polyak towards the best tour found
+// the subgradient steps take their trees over the symmetric candidate graph, so that an iteration costs O(n k log n)
+// instead of O(n^2), but a min 1-tree over a subgraph can be heavier than the true one, so it is only an estimate:
+// the best pi so far is checked now and then with a dense Prim over all edges, which takes at most a quarter of the time,
+// and only those bounds are reported, with --neighbors=0 every tree is dense and every bound is reported
+// it runs on its own thread, reads the best tour distance from shared and writes the best bound back into it
+template<typename Distance>
+auto held_karp_bound(const Distance & distance_matrix, const NeighborList & neighbor_list, SharedTour & shared, 
+                        const atomic<bool> & done)
+{
+    auto node_count = static_cast<int>(shared.order.size());
+    if(node_count < 3) return;
+
+    // symmetric candidate graph in compressed rows, the complete graph when there are no candidate lists
+    vector<int> row_begin(node_count + 1, 0), adjacent;
+    if(neighbor_list.k > 0)
+    {
+        vector<tuple<int, int>> edges;
+        for(auto i = 0; i < node_count; ++i)
+        {
+            for(auto it = neighbor_list.begin(i); it != neighbor_list.end(i); ++it)
+            {
+                edges.push_back(make_tuple(i, *it));
+                edges.push_back(make_tuple(*it, i));
+            }
+        }
+
+        // the nearest neighbors of a clustered instance may leave clusters apart, so the smallest component of
+        // nodes 1..n-1 is joined to the rest by its shortest outgoing edge until the graph is connected
+        auto components = DisjointSet(node_count);
+        for(auto [i, j] : edges)
+        {
+            if(i != 0 && j != 0) components.unite(i, j);
+        }
+        while(true)
+        {
+            vector<int> size(node_count, 0);
+            for(auto i = 1; i < node_count; ++i) ++size[components.find(i)];
+
+            auto smallest = -1;
+            for(auto i = 1; i < node_count; ++i)
+            {
+                if(size[i] > 0 && (smallest == -1 || size[i] < size[smallest])) smallest = i;
+            }
+            if(size[smallest] == node_count - 1) break;
+
+            auto best = (numeric_limits<double>::max)();
+            auto best_i = -1, best_j = -1;
+            for(auto i = 1; i < node_count; ++i)
+            {
+                if(components.find(i) != smallest) continue;
+                for(auto j = 1; j < node_count; ++j)
+                {
+                    if(components.find(j) != smallest && distance_matrix(i, j) < best)
+                    {
+                        best = distance_matrix(i, j);
+                        best_i = i;
+                        best_j = j;
+                    }
+                }
+            }
+            edges.push_back(make_tuple(best_i, best_j));
+            edges.push_back(make_tuple(best_j, best_i));
+            components.unite(best_i, best_j);
+        }
+
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+        for(auto [i, j] : edges)
+        {
+            ++row_begin[i + 1];
+            adjacent.push_back(j);
+        }
+        partial_sum(row_begin.begin(), row_begin.end(), row_begin.begin());
+    }
+
+    vector<double> pi(node_count, 0.0), key(node_count);
+    vector<int> degree(node_count), parent(node_count);
+    vector<char> in_tree(node_count);
+
+    auto weight = [&](int i, int j)
+    {
+        return distance_matrix(i, j) + pi[i] + pi[j];
+    };
+
+    // weight of the min 1-tree in tree, over all edges if dense, or else over the candidate graph,
+    // with the degree of every node, false if the candidate graph is not connected
+    auto one_tree = [&](double & tree, bool dense)
+    {
+        fill(key.begin(), key.end(), (numeric_limits<double>::max)());
+        fill(in_tree.begin(), in_tree.end(), 0);
+        fill(degree.begin(), degree.end(), 0);
+
+        auto total = 0.0;
+        auto tree_size = 0;
+        auto add_node = [&](int i)
+        {
+            in_tree[i] = 1;
+            ++tree_size;
+            if(i != 1)
+            {
+                total += key[i];
+                ++degree[i];
+                ++degree[parent[i]];
+            }
+        };
+
+        if(dense)
+        {
+            // dense Prim on the nodes 1..n-1
+            key[1] = 0;
+            for(auto step = 1; step < node_count; ++step)
+            {
+                auto u = -1;
+                for(auto i = 1; i < node_count; ++i)
+                {
+                    if(!in_tree[i] && (u == -1 || key[i] < key[u])) u = i;
+                }
+                add_node(u);
+                for(auto i = 1; i < node_count; ++i)
+                {
+                    if(!in_tree[i] && weight(u, i) < key[i])
+                    {
+                        key[i] = weight(u, i);
+                        parent[i] = u;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // sparse Prim on the nodes 1..n-1, with a lazy heap
+            priority_queue<tuple<double, int>, vector<tuple<double, int>>, greater<tuple<double, int>>> heap;
+            key[1] = 0;
+            heap.push(make_tuple(0.0, 1));
+            while(!heap.empty())
+            {
+                auto [k, u] = heap.top();
+                heap.pop();
+                if(in_tree[u] || k > key[u]) continue;
+
+                add_node(u);
+                for(auto e = row_begin[u]; e < row_begin[u + 1]; ++e)
+                {
+                    auto i = adjacent[e];
+                    if(i == 0 || in_tree[i]) continue;
+
+                    auto w = weight(u, i);
+                    if(w < key[i])
+                    {
+                        key[i] = w;
+                        parent[i] = u;
+                        heap.push(make_tuple(w, i));
+                    }
+                }
+            }
+        }
+        if(tree_size < node_count - 1) return false;
+
+        // the two cheapest edges of node 0
+        auto first = (numeric_limits<double>::max)(), second = first;
+        auto first_node = -1, second_node = -1;
+        auto try_edge = [&](int i)
+        {
+            auto w = weight(0, i);
+            if(w < first)
+            {
+                second = first;
+                second_node = first_node;
+                first = w;
+                first_node = i;
+            }
+            else if(w < second)
+            {
+                second = w;
+                second_node = i;
+            }
+        };
+        if(dense)
+        {
+            for(auto i = 1; i < node_count; ++i) try_edge(i);
+        }
+        else
+        {
+            for(auto e = row_begin[0]; e < row_begin[1]; ++e) try_edge(adjacent[e]);
+        }
+        if(second_node == -1) return false;
+
+        degree[0] = 2;
+        ++degree[first_node];
+        ++degree[second_node];
+        tree = total + first + second;
+        return true;
+    };
+
+    // the true min 1-tree at the best pi of the candidate graph, which is a proven bound
+    auto sparse = neighbor_list.k > 0;
+    auto best_pi = pi;
+    auto checked = true;
+    auto dense_seconds = 0.0;
+    auto dense_end = chrono::steady_clock::now();
+    auto check = [&]()
+    {
+        auto start = chrono::steady_clock::now();
+        swap(pi, best_pi);
+
+        auto tree = 0.0;
+        one_tree(tree, true);
+        auto bound = tree - 2 * accumulate(pi.begin(), pi.end(), 0.0);
+        if(bound > shared.lower_bound.load()) shared.lower_bound.store(bound);
+
+        swap(pi, best_pi);
+        checked = true;
+        dense_end = chrono::steady_clock::now();
+        dense_seconds = chrono::duration<double>(dense_end - start).count();
+    };
+
+    auto best_bound = 0.0;
+    auto step_scale = 2.0;
+    auto stall_count = 0;
+    for(auto iteration = 1; !done.load() && step_scale > 1e-6; ++iteration)
+    {
+        if(!checked && chrono::duration<double>(chrono::steady_clock::now() - dense_end).count() >= 3 * dense_seconds) check();
+
+        auto tree = 0.0;
+        if(!one_tree(tree, !sparse))
+        {
+            printf("[lower bound] the candidate graph is not connected\n");
+            return;
+        }
+
+        auto bound = tree - 2 * accumulate(pi.begin(), pi.end(), 0.0);
+        if(bound > best_bound)
+        {
+            best_bound = bound;
+            stall_count = 0;
+            if(sparse)
+            {
+                best_pi = pi;
+                checked = false;
+            }
+            else shared.lower_bound.store(best_bound);
+        }
+        else if(++stall_count == 50)
+        {
+            step_scale /= 2;
+            stall_count = 0;
+        }
+
+        auto norm = 0.0;
+        for(auto i = 0; i < node_count; ++i)
+        {
+            norm += (degree[i] - 2) * (degree[i] - 2);
+        }
+
+        // every node has degree 2, the 1-tree is a tour, and the bound is optimal
+        auto upper_bound = shared.distance.load();
+        if(norm == 0 || bound >= upper_bound) break;
+
+        auto step = step_scale * (upper_bound - bound) / norm;
+        for(auto i = 0; i < node_count; ++i)
+        {
+            pi[i] += step * (degree[i] - 2);
+        }
+    }
+
+    if(!checked && !done.load()) check();
+}
+
+template<typename Activate, typename Distance>
+// one guided local search trajectory, run by each island with its own penalties, lambda and random generator
+// every island scales lambda a little differently, otherwise islands starting from the same tour would stay in lockstep
+auto search(const Tour & tour, const Distance & distance_matrix, const NeighborList & neighbor_list, const Options & options, 
+            SharedTour & shared, int island)
+{
+    auto penalty = Penalty(tour.size());
+    auto alpha_scale = array<double, 5>{ 1.0, 1.5, 0.7, 2.0, 0.5 };
+    auto alpha = 0.1 * alpha_scale[island % alpha_scale.size()];
+    auto lambda = 0.0;
+    auto generator = default_random_engine(static_cast<unsigned>(time(nullptr)) + island);
+
+    auto activate = Activate(tour.size());
+
+    auto current_tour = tour;
+    auto current_distance = total_distance(current_tour, distance_matrix);
+    auto current_augmented_distance = total_augmented_distance(current_tour, distance_matrix, penalty, lambda);
+
+    auto utility = get_utility_heap(current_tour, distance_matrix, penalty);
+    auto touched = vector<int>();
+
+    auto best_tour = current_tour;
+    auto best_distance = current_distance;
+
+    auto shared_order = vector<int>();
+    auto shared_distance = 0.0;
+
+    for (auto cur_step = 0; cur_step < options.step_limit; ++cur_step)
+    {
+        if(options.time_limit > 0 && shared.seconds() > options.time_limit) break;
+
+        auto gap = shared.gap();
+        if(options.target_gap > 0 && gap >= 0 && gap <= options.target_gap) break;
+
+        if(options.thread_count == 1 && shared.report)
+        {
+            printf("[step %-8d] [current distance %lf] [current augmented distance %lf] [best distance %lf]", 
+                    cur_step + 1, current_distance, current_augmented_distance, best_distance);
+            if(gap >= 0) printf(" [gap %.3lf%%]", gap);
+            printf("\n");
+        }
+
+        // an island that lags behind the shared best tour moves over to it, but keeps its own penalties
+        if(options.thread_count > 1 && cur_step > 0 && cur_step % options.exchange_interval == 0 && 
+            best_distance > shared.distance.load() && shared.read(shared_order, shared_distance))
+        {
+            current_tour = Tour(shared_order);
+            current_distance = total_distance(current_tour, distance_matrix);
+            current_augmented_distance = total_augmented_distance(current_tour, distance_matrix, penalty, lambda);
+            utility = get_utility_heap(current_tour, distance_matrix, penalty);
+            best_tour = current_tour;
+            best_distance = current_distance;
+
+            for(auto i = 0; i < current_tour.size(); ++i)
+            {
+                activate.set_1(i);
+            }
+        }
+        
+        while(!activate.empty())
+        {
+            auto bit = activate.next();
+
+            auto bit_in = current_tour.prev(bit);
+            auto bit_out = current_tour.next(bit);
+
+            auto t1_t2_candidate = vector<tuple<int, int>>{ make_tuple(bit_in, bit), make_pair(bit, bit_out) };
+            auto improved = false;
+
+            for(auto j = 0; j < t1_t2_candidate.size() && !improved; ++j)
+            {
+                auto [t1, t2] = t1_t2_candidate[j];
+
+                if(options.move == "lk")
+                {
+                    touched.clear();
+                    improved = lk_move(t1, t2, current_tour, distance_matrix, penalty, utility, current_distance, 
+                                        current_augmented_distance, lambda, neighbor_list, options.lk_depth, touched);
+                    for(auto i : touched)
+                    {
+                        activate.set_1(i);
+                    }
+                    continue;
+                }
+
+                auto [t3, t4] = select_t3_t4(t1, t2, current_tour, distance_matrix, penalty, lambda, neighbor_list, generator);
+
+                if(t3 == -1) continue;
+
+                swap_edge(t1, t2, t3, t4, current_tour, distance_matrix, penalty, utility, current_distance, current_augmented_distance, lambda);
+                
+                activate.set_1(t1);
+                activate.set_1(t2);
+                activate.set_1(t3);
+                activate.set_1(t4);
+
+                improved = true;
+            }
+
+            // segments starting at bit are only relocated once no 2-opt move around bit improves
+            if(!improved && options.or_opt)
+            {
+                auto [s2, c, d, reversed] = select_or_opt(bit, current_tour, distance_matrix, penalty, lambda, neighbor_list, generator);
+
+                if(s2 != -1)
+                {
+                    activate.set_1(current_tour.prev(bit));
+                    activate.set_1(current_tour.next(s2));
+
+                    move_segment(bit, s2, c, d, reversed, current_tour, distance_matrix, penalty, utility, 
+                                    current_distance, current_augmented_distance, lambda);
+
+                    activate.set_1(bit);
+                    activate.set_1(s2);
+                    activate.set_1(c);
+                    activate.set_1(d);
+
+                    improved = true;
+                }
+            }
+
+            if(!improved)
+            {
+                activate.set_0(bit);
+            }
+
+            if (best_distance > current_distance)
+            {
+                best_tour = current_tour;
+                best_distance = current_distance;
+            }
+        }
+        shared.publish(best_tour, best_distance, island);
+
+        if(lambda == 0.0) lambda = init_lambda(tour, distance_matrix, alpha);
+        add_penalty(current_tour, distance_matrix, penalty, utility, activate, current_augmented_distance, lambda);
+    }
+
+    shared.publish(best_tour, best_distance, island);
+}
+
+// decomposition for very large instances: the tour is cut into sub-paths of partition_size consecutive nodes, which are
+// searched in parallel with their endpoints fixed, and put back in place, then the cuts move by half a sub-path, so that
+// the edges between two sub-paths in one round are inside a sub-path in the next round
+// consecutive nodes of a tour that has gone through local search already lie close to each other, so a sub-path is
+// spatially compact, and its search only needs the candidate lists of its own nodes
+template<typename Activate, typename Distance>
+auto partition_search(const vector<Node> & node_vec, const Tour & tour, const Distance & distance_matrix, const Options & options)
+{
+    auto order = tour.order;
+    auto node_count = static_cast<int>(order.size());
+    auto part_size = max(8, min(options.partition_size, node_count));
+    auto part_count = max(1, node_count / part_size);
+    auto start_time = chrono::steady_clock::now();
+
+    auto sub_options = options;
+    sub_options.thread_count = 1;
+    sub_options.step_limit = options.partition_steps;
+
+    // search order[lo..hi) as a cycle closed by the fixed edge between its endpoints, then walk the best cycle from
+    // the first endpoint to the last one, away from the fixed edge
+    auto optimize = [&](int lo, int hi)
+    {
+        auto global = vector<int>(order.begin() + lo, order.begin() + hi);
+        auto size = static_cast<int>(global.size());
+
+        auto sub_node_vec = vector<Node>(size);
+        for(auto i = 0; i < size; ++i)
+        {
+            sub_node_vec[i] = node_vec[global[i]];
+        }
+        auto sub_neighbor_list = get_neighbor_list(sub_node_vec, options.neighbor_count);
+        auto sub_distance = SubPathDistance<Distance>(distance_matrix, global);
+
+        auto path = vector<int>(size);
+        iota(path.begin(), path.end(), 0);
+        auto sub_tour = Tour(path);
+        auto shared = SharedTour(sub_tour, total_distance(sub_tour, sub_distance), false, start_time);
+        search<Activate>(sub_tour, sub_distance, sub_neighbor_list, sub_options, shared, 0);
+
+        auto best_distance = 0.0;
+        shared.read(path, best_distance);
+        auto best_tour = Tour(path);
+
+        auto forward = best_tour.next(0) != size - 1;
+        for(auto i = 0, node = 0; i < size; ++i)
+        {
+            order[lo + i] = global[node];
+            node = forward ? best_tour.next(node) : best_tour.prev(node);
+        }
+    };
+
+    for(auto round = 0; round < options.partition_rounds; ++round)
+    {
+        auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        if(options.time_limit > 0 && seconds > options.time_limit) break;
+
+        // sub-paths write back into disjoint ranges of order, so threads only share the index of the next sub-path
+        atomic<int> next_part(0);
+        auto worker = [&]()
+        {
+            for(auto part = next_part++; part < part_count; part = next_part++)
+            {
+                // past the deadline, the remaining sub-paths stay as they are
+                if(options.time_limit > 0 && 
+                    chrono::duration<double>(chrono::steady_clock::now() - start_time).count() > options.time_limit) break;
+
+                auto lo = part * part_size;
+                auto hi = part + 1 == part_count ? node_count : lo + part_size;
+                if(hi - lo >= 8) optimize(lo, hi);
+            }
+        };
+
+        vector<thread> threads;
+        for(auto i = 1; i < options.thread_count; ++i)
+        {
+            threads.push_back(thread(worker));
+        }
+        worker();
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+
+        auto round_tour = Tour(order);
+        auto distance = total_distance(round_tour, distance_matrix);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        printf("[round %-4d] [sub-paths %d] [time %.3lfs] [distance %lf]\n", round + 1, part_count, seconds, distance);
+        save_result("cpp_output.txt", distance, round_tour);
+
+        rotate(order.begin(), order.begin() + part_size / 2, order.end());
+    }
+
+    return Tour(order);
+}
+
+// backbone mode: the edges shared by K good tours are very likely in the optimal tour too, so they are fixed, and every
+// chain of fixed edges is collapsed into its two endpoints joined by one fixed edge, then the reduced instance is
+// searched and every chain is expanded back in place
+// the K tours come from earlier result files and from K independent trials from the starting tour, run in parallel
+template<typename Activate, typename Distance>
+auto backbone_search(const vector<Node> & node_vec, const Tour & tour, const Distance & distance_matrix, 
+                        const NeighborList & neighbor_list, const Options & options)
+{
+    auto node_count = tour.size();
+    auto phase_time = chrono::steady_clock::now();
+    auto phase_seconds = [&]()
+    {
+        auto now = chrono::steady_clock::now();
+        auto seconds = chrono::duration<double>(now - phase_time).count();
+        phase_time = now;
+        return seconds;
+    };
+
+    vector<vector<int>> orders;
+    for(auto begin = 0; begin < options.backbone_files.size(); )
+    {
+        auto end = options.backbone_files.find(',', begin);
+        if(end == string::npos) end = options.backbone_files.size();
+        if(end > begin) orders.push_back(load_tour(options.backbone_files.substr(begin, end - begin).c_str(), node_count));
+        begin = end + 1;
+    }
+
+    auto file_count = static_cast<int>(orders.size());
+    orders.resize(file_count + options.backbone_count);
+
+    auto trial_options = options;
+    trial_options.thread_count = 1;
+    trial_options.step_limit = options.backbone_steps;
+    trial_options.time_limit = 0;
+
+    // trials write into their own slot of orders, so threads only share the index of the next trial
+    atomic<int> next_trial(0);
+    auto worker = [&]()
+    {
+        for(auto trial = next_trial++; trial < options.backbone_count; trial = next_trial++)
+        {
+            auto shared = SharedTour(tour, total_distance(tour, distance_matrix), false);
+            search<Activate>(tour, distance_matrix, neighbor_list, trial_options, shared, trial);
+
+            auto trial_distance = 0.0;
+            shared.read(orders[file_count + trial], trial_distance);
+        }
+    };
+
+    vector<thread> threads;
+    for(auto i = 1; i < options.thread_count; ++i)
+    {
+        threads.push_back(thread(worker));
+    }
+    worker();
+    for(auto & t : threads)
+    {
+        t.join();
+    }
+
+    auto best_tour = Tour(orders[0]);
+    auto best_distance = total_distance(best_tour, distance_matrix);
+    for(auto & order : orders)
+    {
+        auto order_tour = Tour(order);
+        auto order_distance = total_distance(order_tour, distance_matrix);
+        if(order_distance < best_distance)
+        {
+            best_tour = order_tour;
+            best_distance = order_distance;
+        }
+    }
+    printf("[backbone tours] [tours %d] [best distance %lf] [time %.3lfs]\n", static_cast<int>(orders.size()), best_distance, 
+            phase_seconds());
+
+    // an edge is in every tour iff its key shows up once per tour
+    vector<int64_t> keys;
+    for(auto & order : orders)
+    {
+        for(auto i = 0; i < node_count; ++i)
+        {
+            auto a = order[i], b = order[(i + 1) % node_count];
+            keys.push_back(static_cast<int64_t>(min(a, b)) * node_count + max(a, b));
+        }
+    }
+    sort(keys.begin(), keys.end());
+
+    vector<array<int, 2>> fixed_adjacent(node_count, array<int, 2>{ -1, -1 });
+    auto fixed_count = 0;
+    for(auto i = 0; i < keys.size(); )
+    {
+        auto j = i;
+        while(j < keys.size() && keys[j] == keys[i]) ++j;
+        if(j - i == orders.size())
+        {
+            auto a = static_cast<int>(keys[i] / node_count), b = static_cast<int>(keys[i] % node_count);
+            fixed_adjacent[a][fixed_adjacent[a][0] == -1 ? 0 : 1] = b;
+            fixed_adjacent[b][fixed_adjacent[b][0] == -1 ? 0 : 1] = a;
+            ++fixed_count;
+        }
+        i = j;
+    }
+
+    // every tour agrees on every edge, there is nothing left to search
+    if(fixed_count == node_count)
+    {
+        printf("[backbone reduce] [fixed edges %d] [reduced nodes 0] [reduction ratio 0.000] [time %.3lfs]\n", 
+                fixed_count, phase_seconds());
+        return best_tour;
+    }
+
+    // walk every chain of fixed edges from one of its ends, a node without fixed edges is a chain by itself
+    // the ends of a chain become the reduced nodes, global maps them back, and mate pairs the two ends of a chain
+    vector<vector<int>> chains;
+    vector<int> global, mate, chain_of;
+    vector<int> reduced_of(node_count, -1);
+    for(auto i = 0; i < node_count; ++i)
+    {
+        if(reduced_of[i] != -1 || fixed_adjacent[i][1] != -1) continue;
+
+        auto chain = vector<int>{ i };
+        for(auto prev = -1, node = i; fixed_adjacent[node][0] != -1; )
+        {
+            auto next = fixed_adjacent[node][0] != prev ? fixed_adjacent[node][0] : fixed_adjacent[node][1];
+            if(next == -1) break;
+            chain.push_back(next);
+            prev = node;
+            node = next;
+        }
+
+        for(auto end : { chain.front(), chain.back() })
+        {
+            if(reduced_of[end] != -1) continue;
+            reduced_of[end] = static_cast<int>(global.size());
+            global.push_back(end);
+            mate.push_back(-1);
+            chain_of.push_back(static_cast<int>(chains.size()));
+        }
+        if(chain.size() > 1)
+        {
+            mate[reduced_of[chain.front()]] = reduced_of[chain.back()];
+            mate[reduced_of[chain.back()]] = reduced_of[chain.front()];
+        }
+        for(auto node : chain)
+        {
+            if(reduced_of[node] == -1) reduced_of[node] = -2;
+        }
+        chains.push_back(chain);
+    }
+
+    auto reduced_count = static_cast<int>(global.size());
+    printf("[backbone reduce] [fixed edges %d] [reduced nodes %d] [reduction ratio %.3lf] [time %.3lfs]\n", 
+            fixed_count, reduced_count, static_cast<double>(reduced_count) / node_count, phase_seconds());
+
+    // the best tour visits every chain in one go, so dropping the inner nodes of chains gives a tour of the reduced nodes
+    auto reduced_order = vector<int>();
+    for(auto node : best_tour.order)
+    {
+        if(reduced_of[node] >= 0) reduced_order.push_back(reduced_of[node]);
+    }
+    auto reduced_tour = Tour(reduced_order);
+
+    if(reduced_count >= 8)
+    {
+        auto reduced_node_vec = vector<Node>(reduced_count);
+        for(auto i = 0; i < reduced_count; ++i)
+        {
+            reduced_node_vec[i] = node_vec[global[i]];
+        }
+        auto reduced_neighbor_list = get_neighbor_list(reduced_node_vec, options.neighbor_count);
+        auto reduced_distance = ReducedDistance<Distance>(distance_matrix, global, mate);
+
+        auto shared = SharedTour(reduced_tour, total_distance(reduced_tour, reduced_distance), false);
+        auto island = [&](int i)
+        {
+            search<Activate>(reduced_tour, reduced_distance, reduced_neighbor_list, options, shared, i);
+        };
+
+        vector<thread> islands;
+        for(auto i = 1; i < options.thread_count; ++i)
+        {
+            islands.push_back(thread(island, i));
+        }
+        island(0);
+        for(auto & t : islands)
+        {
+            t.join();
+        }
+
+        auto shared_distance = 0.0;
+        shared.read(reduced_order, shared_distance);
+        reduced_tour = Tour(reduced_order);
+    }
+    // the fixed edge of a chain stands for the whole chain in the reduced tour
+    auto chain_distance = 0.0;
+    for(auto & chain : chains)
+    {
+        for(auto i = 0; i + 1 < chain.size(); ++i)
+        {
+            chain_distance += distance_matrix(chain[i], chain[i + 1]);
+        }
+        chain_distance -= distance_matrix(chain.front(), chain.back());
+    }
+    printf("[backbone search] [distance %lf] [time %.3lfs]\n", 
+            total_distance(reduced_tour, ReducedDistance<Distance>(distance_matrix, global, mate)) + chain_distance, phase_seconds());
 
-    auto best_connection = search(connection, distance_matrix);
-    auto best_distance = total_distance(best_connection, distance_matrix);
+    // put every chain back between its two ends, which the fixed edge kept next to each other
+    auto order = vector<int>();
+    auto expanded = vector<char>(chains.size(), 0);
+    for(auto r : reduced_tour.order)
+    {
+        auto c = chain_of[r];
+        if(expanded[c]) continue;
+        expanded[c] = 1;
+
+        auto & chain = chains[c];
+        auto first = mate[r] == -1 || reduced_tour.next(r) == mate[r] ? r : mate[r];
+        assert(mate[r] == -1 || reduced_tour.next(r) == mate[r] || reduced_tour.prev(r) == mate[r]);
+        if(global[first] == chain.front()) order.insert(order.end(), chain.begin(), chain.end());
+        else order.insert(order.end(), chain.rbegin(), chain.rend());
+    }
+
+    auto result = Tour(order);
+    printf("[backbone expand] [distance %lf] [time %.3lfs]\n", total_distance(result, distance_matrix), phase_seconds());
+    return result;
+}
+
+// exact re-sequencing of the interior of a window of consecutive tour nodes with fixed endpoints, by the Held-Karp
+// dynamic program over subsets: cost[mask][last] is the shortest path from the first endpoint through the interior
+// nodes in mask, ending at interior node last, which is O(2^m m^2) for m interior nodes
+// the tables are allocated once for the largest window, aligned to cache lines, and reused for every window
+struct WindowDp
+{
+    static constexpr int max_window = 14;
+    static constexpr int max_interior = max_window - 2;
+
+    WindowDp(): cost(static_cast<double *>(aligned_alloc(64, sizeof(double) << max_interior << 4))), 
+        parent(static_cast<int8_t *>(aligned_alloc(64, size_t(1) << max_interior << 4))) {}
+
+    WindowDp(const WindowDp &) = delete;
+    WindowDp & operator=(const WindowDp &) = delete;
+
+    ~WindowDp()
+    {
+        free(cost);
+        free(parent);
+    }
+
+    // re-sequence path[1..size-2] in place, the improvement of the path length is returned, 0 if it is optimal already
+    template<typename Distance>
+    double optimize(int * path, int size, const Distance & distance_matrix)
+    {
+        auto m = size - 2;
+        if(m < 2) return 0;
+
+        // distances between the window nodes, index 0 and m + 1 are the endpoints, the interior is 1..m
+        for(auto i = 0; i < size; ++i)
+        {
+            for(auto j = i + 1; j < size; ++j)
+            {
+                local[i][j] = local[j][i] = distance_matrix(path[i], path[j]);
+            }
+        }
+
+        auto old_length = 0.0;
+        for(auto i = 0; i + 1 < size; ++i)
+        {
+            old_length += local[i][i + 1];
+        }
+
+        // row stride of 16, so that every row of cost starts on a cache line
+        auto full = (1 << m) - 1;
+        fill(cost, cost + (static_cast<size_t>(full + 1) << 4), (numeric_limits<double>::max)());
+        for(auto j = 0; j < m; ++j)
+        {
+            cost[static_cast<size_t>(1 << j) << 4 | j] = local[0][j + 1];
+        }
+
+        for(auto mask = 1; mask < full; ++mask)
+        {
+            auto row = cost + (static_cast<size_t>(mask) << 4);
+            for(auto last = 0; last < m; ++last)
+            {
+                if(!(mask >> last & 1) || row[last] == (numeric_limits<double>::max)()) continue;
+                for(auto next = 0; next < m; ++next)
+                {
+                    if(mask >> next & 1) continue;
+
+                    auto next_mask = static_cast<size_t>(mask | 1 << next) << 4;
+                    auto c = row[last] + local[last + 1][next + 1];
+                    if(c < cost[next_mask | next])
+                    {
+                        cost[next_mask | next] = c;
+                        parent[next_mask | next] = static_cast<int8_t>(last);
+                    }
+                }
+            }
+        }
+
+        auto new_length = (numeric_limits<double>::max)();
+        auto last = -1;
+        for(auto j = 0; j < m; ++j)
+        {
+            auto c = cost[static_cast<size_t>(full) << 4 | j] + local[j + 1][m + 1];
+            if(c < new_length)
+            {
+                new_length = c;
+                last = j;
+            }
+        }
+
+        // ties and rounding would otherwise rewrite a window back and forth
+        if(new_length >= old_length - 1e-9 * old_length) return 0;
+
+        auto interior = array<int, max_interior>();
+        for(auto i = 0; i < m; ++i)
+        {
+            interior[i] = path[i + 1];
+        }
+        // walk back from the last interior node, the first one has no parent, its mask has a single bit
+        for(auto i = m, mask = full; ; --i)
+        {
+            path[i] = interior[last];
+            if(i == 1) break;
+
+            auto previous = parent[static_cast<size_t>(mask) << 4 | last];
+            mask ^= 1 << last;
+            last = previous;
+        }
+        return old_length - new_length;
+    }
+
+    double * cost;
+    int8_t * parent;
+    double local[max_window][max_window];
+};
+
+// slide windows of window_size consecutive nodes along the tour and re-sequence each of them exactly
+// the windows of one pass only share their fixed endpoints, so threads take windows from a counter and write back into
+// disjoint ranges of order, and the next pass starts half a window later, so that the joints get optimized too
+// passes go on until two of them in a row find nothing
+template<typename Distance>
+auto window_search(const Tour & tour, const Distance & distance_matrix, const Options & options)
+{
+    auto order = tour.order;
+    auto node_count = static_cast<int>(order.size());
+    auto window_size = min(options.window_size, node_count - 1);
+    if(window_size < 4) return tour;
+
+    auto stride = window_size - 1;
+    auto window_count = node_count / stride;
+    auto start_time = chrono::steady_clock::now();
+    auto distance = total_distance(tour, distance_matrix);
+
+    vector<WindowDp> tables(options.thread_count);
+
+    auto offset = 0;
+    for(auto pass = 0, idle_count = 0; idle_count < 2; ++pass, offset += stride / 2)
+    {
+        atomic<int> next_window(0);
+        vector<double> gain(options.thread_count, 0.0);
+        auto worker = [&](int t)
+        {
+            int path[WindowDp::max_window];
+            for(auto w = next_window++; w < window_count; w = next_window++)
+            {
+                auto start = offset + w * stride;
+                for(auto i = 0; i < window_size; ++i)
+                {
+                    path[i] = order[(start + i) % node_count];
+                }
+
+                auto improvement = tables[t].optimize(path, window_size, distance_matrix);
+                if(improvement == 0) continue;
+
+                gain[t] += improvement;
+                for(auto i = 1; i + 1 < window_size; ++i)
+                {
+                    order[(start + i) % node_count] = path[i];
+                }
+            }
+        };
+
+        vector<thread> threads;
+        for(auto i = 1; i < options.thread_count; ++i)
+        {
+            threads.push_back(thread(worker, i));
+        }
+        worker(0);
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+
+        auto pass_gain = accumulate(gain.begin(), gain.end(), 0.0);
+        idle_count = pass_gain > 0 ? 0 : idle_count + 1;
+        distance -= pass_gain;
+
+        auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        printf("[window pass %-4d] [windows %d] [time %.3lfs] [distance %lf]\n", pass + 1, window_count, seconds, distance);
+    }
+
+    return Tour(order);
+}
+
+// evaluate the 2-opt moves of every tour edge over and over for about a second, and report how many moves are evaluated per second
+template<typename Distance>
+auto benchmark_distance(const char * name, const Tour & tour, const Distance & distance_matrix, 
+                        const NeighborList & neighbor_list)
+{
+    auto penalty = Penalty(tour.size());
+    auto generator = default_random_engine(0);
+    auto node_count = static_cast<int>(tour.size());
+    auto moves_per_call = neighbor_list.k == 0 ? node_count : 2 * neighbor_list.k;
+
+    auto start_time = chrono::steady_clock::now();
+    auto seconds = 0.0;
+    auto call_count = 0LL;
+    auto found = 0LL;
+    while(seconds < 1.0)
+    {
+        for(auto t1 = 0; t1 < node_count; ++t1)
+        {
+            auto [t3, t4] = select_t3_t4(t1, tour.next(t1), tour, distance_matrix, penalty, 0.0, neighbor_list, generator);
+            found += t3 != -1;
+        }
+        call_count += node_count;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    }
+
+    printf("[distance %-8s] [moves/sec %.0lf] [improving moves found %lld]\n", name, call_count * moves_per_call / seconds, found);
+}
+
+// gains per second of every gain kernel the cpu supports, on the candidate moves of the given tour with random penalties,
+// and the number of gains that differ from the scalar kernel, which must be zero
+auto benchmark_gain_kernel(const Tour & tour, const EuclideanDistance & distance_matrix, const NeighborList & neighbor_list)
+{
+    auto node_count = static_cast<int>(tour.size());
+    auto generator = default_random_engine(0);
+    auto random_penalty = uniform_int_distribution<int>(0, 3);
+    auto lambda = 0.1 * total_distance(tour, distance_matrix) / node_count;
+
+    // one block of moves for each t1, with t2 = next(t1), in the order select_t3_t4 looks at them
+    vector<int> t3, t4, block_begin(1, 0);
+    for(auto t1 = 0; t1 < node_count; ++t1)
+    {
+        auto t2 = tour.next(t1);
+        for(auto it = neighbor_list.begin(t1); it != neighbor_list.end(t1); ++it)
+        {
+            t4.push_back(tour.next(*it));
+        }
+        for(auto it = neighbor_list.begin(t2); it != neighbor_list.end(t2); ++it)
+        {
+            t4.push_back(*it);
+        }
+        while(t3.size() < t4.size()) t3.push_back(tour.prev(t4[t3.size()]));
+        block_begin.push_back(t4.size());
+    }
+
+    vector<double> p34(t4.size()), p13(t4.size()), p24(t4.size()), c12(node_count);
+    for(auto i = 0; i < t4.size(); ++i)
+    {
+        p34[i] = random_penalty(generator);
+        p13[i] = random_penalty(generator);
+        p24[i] = random_penalty(generator);
+    }
+    for(auto t1 = 0; t1 < node_count; ++t1)
+    {
+        c12[t1] = distance_matrix(t1, tour.next(t1)) + lambda * random_penalty(generator);
+    }
+
+    auto run_kernel = [&](GainKernel kernel, vector<double> & gain)
+    {
+        for(auto t1 = 0; t1 < node_count; ++t1)
+        {
+            auto b = block_begin[t1];
+            kernel(distance_matrix.x.data(), distance_matrix.y.data(), t1, tour.next(t1), t3.data() + b, t4.data() + b, 
+                    p34.data() + b, p13.data() + b, p24.data() + b, c12[t1], lambda, block_begin[t1 + 1] - b, gain.data() + b);
+        }
+    };
+
+    vector<double> scalar_gain(t4.size()), gain(t4.size());
+    run_kernel(gain_scalar, scalar_gain);
+
+    for(auto name : { "scalar", "avx2", "avx512" })
+    {
+        auto kernel = get_gain_kernel(name);
+        if(!kernel)
+        {
+            printf("[gain kernel %-8s] [not supported]\n", name);
+            continue;
+        }
+
+        auto start_time = chrono::steady_clock::now();
+        auto seconds = 0.0;
+        auto call_count = 0LL;
+        while(seconds < 1.0)
+        {
+            run_kernel(kernel, gain);
+            ++call_count;
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        }
+
+        auto mismatch_count = 0;
+        for(auto i = 0; i < gain.size(); ++i)
+        {
+            mismatch_count += memcmp(&gain[i], &scalar_gain[i], sizeof(double)) != 0;
+        }
+        printf("[gain kernel %-8s] [gains/sec %.0lf] [mismatches %d]\n", name, call_count * gain.size() / seconds, mismatch_count);
+
+        // every kernel has to pick the same moves as the scalar one
+        assert(mismatch_count == 0);
+    }
+}
+
+auto print_usage()
+{
+    printf("Usage: ./main <data-file> [--neighbors=K] [--steps=N] [--distance=euclid|float|matrix] [--activation=queue|sweep] [--init=nn|greedy|sfc|scan]\n"
+           "             [--move=2opt|lk] [--lk-depth=D] [--or-opt=on|off]\n"
+           "             [--threads=N] [--exchange=STEPS] [--time=SECONDS] [--bound=on|off] [--gap=PERCENT]\n"
+           "             [--simd=auto|avx512|avx2|scalar] [--window=W]\n"
+           "             [--backbone=K] [--backbone-steps=N] [--backbone-files=FILE,FILE,...]\n"
+           "             [--partition=SIZE] [--partition-rounds=R] [--partition-steps=N] [--benchmark]\n");
+    printf("Example: ./main data/tsp_51_1\n");
+    printf("Example: ./main data/tsp_33810_1 --neighbors=8 --steps=100000\n");
+}
+
+auto parse_options(int argc, char * argv[])
+{
+    Options options;
+    for(auto i = 1; i < argc; ++i)
+    {
+        auto arg = argv[i];
+        auto value = strchr(arg, '=');
+
+        if(strncmp(arg, "--", 2) != 0)
+        {
+            options.data_file = arg;
+        }
+        else if(value && strncmp(arg, "--neighbors=", 12) == 0)
+        {
+            options.neighbor_count = max(0, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--distance=", 11) == 0)
+        {
+            options.distance = value + 1;
+        }
+        else if(value && strncmp(arg, "--activation=", 13) == 0)
+        {
+            options.activation = value + 1;
+        }
+        else if(value && strncmp(arg, "--threads=", 10) == 0)
+        {
+            options.thread_count = max(1, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--exchange=", 11) == 0)
+        {
+            options.exchange_interval = max(1, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--time=", 7) == 0)
+        {
+            options.time_limit = max(0.0, atof(value + 1));
+        }
+        else if(value && strncmp(arg, "--bound=", 8) == 0)
+        {
+            options.bound = strcmp(value + 1, "on") == 0;
+        }
+        else if(value && strncmp(arg, "--gap=", 6) == 0)
+        {
+            options.target_gap = max(0.0, atof(value + 1));
+        }
+        else if(value && strncmp(arg, "--window=", 9) == 0)
+        {
+            options.window_size = max(0, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--backbone=", 11) == 0)
+        {
+            options.backbone_count = max(0, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--backbone-steps=", 17) == 0)
+        {
+            options.backbone_steps = max(1, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--backbone-files=", 17) == 0)
+        {
+            options.backbone_files = value + 1;
+        }
+        else if(value && strncmp(arg, "--partition=", 12) == 0)
+        {
+            options.partition_size = max(0, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--partition-rounds=", 19) == 0)
+        {
+            options.partition_rounds = max(1, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--partition-steps=", 18) == 0)
+        {
+            options.partition_steps = max(1, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--simd=", 7) == 0)
+        {
+            options.simd = value + 1;
+        }
+        else if(value && strncmp(arg, "--move=", 7) == 0)
+        {
+            options.move = value + 1;
+        }
+        else if(value && strncmp(arg, "--lk-depth=", 11) == 0)
+        {
+            options.lk_depth = max(1, atoi(value + 1));
+        }
+        else if(value && strncmp(arg, "--or-opt=", 9) == 0)
+        {
+            options.or_opt = strcmp(value + 1, "off") != 0;
+        }
+        else if(value && strncmp(arg, "--init=", 7) == 0)
+        {
+            options.init = value + 1;
+        }
+        else if(strcmp(arg, "--benchmark") == 0)
+        {
+            options.benchmark = true;
+        }
+        else if(value && strncmp(arg, "--steps=", 8) == 0)
+        {
+            options.step_limit = max(1, atoi(value + 1));
+        }
+        else
+        {
+            printf("Unknown option: %s\n", arg);
+            print_usage();
+            exit(-1);
+        }
+    }
+
+    if(!options.data_file)
+    {
+        print_usage();
+        exit(-1);
+    }
+
+    if(options.activation != "queue" && options.activation != "sweep")
+    {
+        printf("Unknown activation: %s\n", options.activation.c_str());
+        exit(-1);
+    }
+
+    if(options.move != "2opt" && options.move != "lk")
+    {
+        printf("Unknown move: %s\n", options.move.c_str());
+        exit(-1);
+    }
+
+    if(options.init != "nn" && options.init != "greedy" && options.init != "sfc" && options.init != "scan")
+    {
+        printf("Unknown init: %s\n", options.init.c_str());
+        exit(-1);
+    }
+
+    if(!get_gain_kernel(options.simd))
+    {
+        printf("Unsupported simd: %s\n", options.simd.c_str());
+        exit(-1);
+    }
+
+    if(options.distance != "euclid" && options.distance != "float" && options.distance != "matrix")
+    {
+        printf("Unknown distance: %s\n", options.distance.c_str());
+        exit(-1);
+    }
+
+    if(options.window_size > WindowDp::max_window)
+    {
+        printf("Window size is at most %d\n", WindowDp::max_window);
+        exit(-1);
+    }
+
+    // a gap target needs the bound
+    if(options.target_gap > 0) options.bound = true;
+
+    if(options.bound && options.partition_size > 0)
+    {
+        printf("--bound and --gap are not supported with --partition\n");
+        exit(-1);
+    }
+
+    auto backbone = options.backbone_count > 0 || !options.backbone_files.empty();
+    if(backbone && (options.bound || options.partition_size > 0))
+    {
+        printf("--backbone is not supported with --bound, --gap or --partition\n");
+        exit(-1);
+    }
+
+    auto file_count = options.backbone_files.empty() ? 0 : count(options.backbone_files.begin(), options.backbone_files.end(), ',') + 1;
+    if(backbone && options.backbone_count + file_count < 2)
+    {
+        printf("--backbone needs at least 2 tours from trials and files\n");
+        exit(-1);
+    }
+
+    return options;
+}
+
+template<typename Distance>
+auto run(const Options & options, const vector<Node> & node_vec, const Distance & distance_matrix, const NeighborList & neighbor_list)
+{
+    auto tour = init_tour(options.init, node_vec, distance_matrix);
+
+    if(options.partition_size > 0 || options.backbone_count > 0 || !options.backbone_files.empty())
+    {
+        auto best_tour = tour;
+        if(options.partition_size > 0)
+        {
+            best_tour = options.activation == "sweep" ? 
+                            partition_search<SweepActivate>(node_vec, tour, distance_matrix, options) : 
+                            partition_search<QueueActivate>(node_vec, tour, distance_matrix, options);
+        }
+        else
+        {
+            best_tour = options.activation == "sweep" ? 
+                            backbone_search<SweepActivate>(node_vec, tour, distance_matrix, neighbor_list, options) : 
+                            backbone_search<QueueActivate>(node_vec, tour, distance_matrix, neighbor_list, options);
+            save_result("cpp_output.txt", total_distance(best_tour, distance_matrix), best_tour);
+        }
+        if(options.window_size > 0)
+        {
+            best_tour = window_search(best_tour, distance_matrix, options);
+            save_result("cpp_output.txt", total_distance(best_tour, distance_matrix), best_tour);
+        }
+        auto best_distance = total_distance(best_tour, distance_matrix);
+
+        printf("best distance : %lf\n", best_distance);
+        printf("best tour:\n");
+        print_tour(best_tour);
+        return;
+    }
+
+    auto shared = SharedTour(tour, total_distance(tour, distance_matrix));
+    save_result("cpp_output.txt", shared.distance.load(), tour);
+
+    auto island = [&](int i)
+    {
+        if(options.activation == "sweep") search<SweepActivate>(tour, distance_matrix, neighbor_list, options, shared, i);
+        else search<QueueActivate>(tour, distance_matrix, neighbor_list, options, shared, i);
+    };
+
+    auto done = atomic<bool>(false);
+    auto bound_thread = thread();
+    if(options.bound)
+    {
+        bound_thread = thread([&]() { held_karp_bound(distance_matrix, neighbor_list, shared, done); });
+    }
+
+    vector<thread> threads;
+    for(auto i = 1; i < options.thread_count; ++i)
+    {
+        threads.push_back(thread(island, i));
+    }
+    island(0);
+    for(auto & t : threads)
+    {
+        t.join();
+    }
+
+    done.store(true);
+    if(bound_thread.joinable()) bound_thread.join();
+
+    auto best_order = vector<int>();
+    auto best_distance = 0.0;
+    shared.read(best_order, best_distance);
+    auto best_tour = Tour(best_order);
+    if(options.window_size > 0)
+    {
+        best_tour = window_search(best_tour, distance_matrix, options);
+        save_result("cpp_output.txt", total_distance(best_tour, distance_matrix), best_tour);
+    }
+    best_distance = total_distance(best_tour, distance_matrix);
 
     printf("best distance : %lf\n", best_distance);
+    if(shared.lower_bound.load() > 0)
+    {
+        printf("lower bound : %lf [gap %.3lf%%]\n", shared.lower_bound.load(), 100 * (best_distance / shared.lower_bound.load() - 1));
+    }
     printf("best tour:\n");
-    print_tour(best_connection);
+    print_tour(best_tour);
+}
+
+int main(int argc, char * argv[])
+{
+    auto options = parse_options(argc, argv);
+
+    gain_kernel = get_gain_kernel(options.simd);
+
+    auto node_vec = load_node(options.data_file);
+    auto neighbor_list = get_neighbor_list(node_vec, options.neighbor_count);
+
+    // a full matrix of more than max_matrix_node_count^2 doubles does not fit in memory
+    auto max_matrix_node_count = 10000;
+
+    if(options.benchmark)
+    {
+        auto tour = init_tour(options.init, node_vec, EuclideanDistance(node_vec));
+        benchmark_distance("euclid", tour, EuclideanDistance(node_vec), neighbor_list);
+        benchmark_distance("float", tour, FloatDistance(node_vec), neighbor_list);
+        if(node_vec.size() <= max_matrix_node_count) benchmark_distance("matrix", tour, MatrixDistance(node_vec), neighbor_list);
+        if(neighbor_list.k > 0) benchmark_gain_kernel(tour, EuclideanDistance(node_vec), neighbor_list);
+        return 0;
+    }
+
+    if(options.distance == "float") run(options, node_vec, FloatDistance(node_vec), neighbor_list);
+    else if(options.distance == "matrix")
+    {
+        if(node_vec.size() > max_matrix_node_count)
+        {
+            printf("Too many nodes for a full distance matrix: %zu > %d\n", node_vec.size(), max_matrix_node_count);
+            exit(-1);
+        }
+        run(options, node_vec, MatrixDistance(node_vec), neighbor_list);
+    }
+    else run(options, node_vec, EuclideanDistance(node_vec), neighbor_list);
 
     return 0;
 }
\ No newline at end of file